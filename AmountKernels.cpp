@@ -0,0 +1,475 @@
+#include "AmountKernels.h"
+#include <atomic>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define AMOUNTKERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang compile AVX2 intrinsics only inside functions that opt in; MSVC always accepts them
+#if defined(AMOUNTKERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#else
+#define AVX2_FUNCTION
+#endif
+
+namespace {
+
+// The kernels read and write Money arrays as plain cent counts
+static_assert(sizeof(Money) == sizeof(qint64) && std::is_standard_layout<Money>::value,
+              "Money must be a bare 64-bit cent count");
+
+inline const qint64 *centsOf(const Money *values)
+{
+    return reinterpret_cast<const qint64 *>(values);
+}
+
+inline qint64 *centsOf(Money *values)
+{
+    return reinterpret_cast<qint64 *>(values);
+}
+
+/**
+ * @brief Computes one net amount the way Transaction::calculateNetAmount() does, counting clamped percentages.
+ */
+inline qint64 netOf(qint64 amount, bool taxed, double percent, size_t &clamped)
+{
+    if (!taxed) {
+        return amount;
+    }
+    if (percent < 0.0) {
+        ++clamped;
+        return amount;
+    }
+    if (percent > 100.0) {
+        ++clamped;
+        return 0;
+    }
+    return amount - Money::fromCents(amount).percentage(percent).toCents();
+}
+
+/**
+ * @brief Negates a value where mask is -1 and keeps it where mask is 0, without a branch.
+ */
+inline qint64 applySign(qint64 value, qint64 mask)
+{
+    return (value ^ mask) - mask;
+}
+
+/**
+ * @brief One implementation of every kernel, working on cent counts.
+ */
+struct KernelTable {
+    size_t (*netAmounts)(const qint64 *, const quint8 *, const quint8 *, const double *, size_t, qint64 *, qint64 *);
+    qint64 (*sum)(const qint64 *, size_t);
+    qint64 (*signedSum)(const qint64 *, const quint8 *, size_t);
+    qint64 (*maskedSum)(const qint64 *, const quint8 *, quint8, const quint8 *, size_t);
+    qint64 (*gatherSum)(const qint64 *, const quint32 *, size_t);
+};
+
+// Scalar kernels; the SIMD ones also use them for their last few elements
+
+size_t netAmountsScalar(const qint64 *amounts, const quint8 *income, const quint8 *withheld, const double *percents,
+                        size_t count, qint64 *net, qint64 *signedNet)
+{
+    size_t clamped = 0;
+    for (size_t i = 0; i < count; ++i) {
+        net[i] = netOf(amounts[i], income[i] != 0 && withheld[i] != 0, percents[i], clamped);
+        signedNet[i] = applySign(net[i], -static_cast<qint64>(income[i] == 0));
+    }
+    return clamped;
+}
+
+qint64 sumScalar(const qint64 *values, size_t count)
+{
+    qint64 total0 = 0;
+    qint64 total1 = 0;
+    qint64 total2 = 0;
+    qint64 total3 = 0;
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        total0 += values[i];
+        total1 += values[i + 1];
+        total2 += values[i + 2];
+        total3 += values[i + 3];
+    }
+    for (; i < count; ++i) {
+        total0 += values[i];
+    }
+    return total0 + total1 + total2 + total3;
+}
+
+qint64 signedSumScalar(const qint64 *values, const quint8 *credit, size_t count)
+{
+    qint64 total0 = 0;
+    qint64 total1 = 0;
+
+    // mask is 0 for credits and -1 for debits
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        total0 += applySign(values[i], -static_cast<qint64>(credit[i] == 0));
+        total1 += applySign(values[i + 1], -static_cast<qint64>(credit[i + 1] == 0));
+    }
+    for (; i < count; ++i) {
+        total0 += applySign(values[i], -static_cast<qint64>(credit[i] == 0));
+    }
+    return total0 + total1;
+}
+
+qint64 maskedSumScalar(const qint64 *values, const quint8 *flags, quint8 wanted, const quint8 *removed, size_t count)
+{
+    qint64 total0 = 0;
+    qint64 total1 = 0;
+
+    // keep is -1 for selected amounts and 0 for the others
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        total0 += values[i] & -static_cast<qint64>(flags[i] == wanted && removed[i] == 0);
+        total1 += values[i + 1] & -static_cast<qint64>(flags[i + 1] == wanted && removed[i + 1] == 0);
+    }
+    for (; i < count; ++i) {
+        total0 += values[i] & -static_cast<qint64>(flags[i] == wanted && removed[i] == 0);
+    }
+    return total0 + total1;
+}
+
+qint64 gatherSumScalar(const qint64 *values, const quint32 *positions, size_t count)
+{
+    qint64 total0 = 0;
+    qint64 total1 = 0;
+    qint64 total2 = 0;
+    qint64 total3 = 0;
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        total0 += values[positions[i]];
+        total1 += values[positions[i + 1]];
+        total2 += values[positions[i + 2]];
+        total3 += values[positions[i + 3]];
+    }
+    for (; i < count; ++i) {
+        total0 += values[positions[i]];
+    }
+    return total0 + total1 + total2 + total3;
+}
+
+const KernelTable ScalarKernels = {netAmountsScalar, sumScalar, signedSumScalar, maskedSumScalar, gatherSumScalar};
+
+#ifdef AMOUNTKERNELS_X86
+
+// SSE2 kernels, eight elements per iteration
+
+/**
+ * @brief Widens eight byte masks (0 or -1) to four vectors of two 64-bit lane masks.
+ */
+inline void widenMask(__m128i bytes, __m128i lanes[4])
+{
+    const __m128i words = _mm_unpacklo_epi8(bytes, bytes);
+    const __m128i low = _mm_unpacklo_epi16(words, words);
+    const __m128i high = _mm_unpackhi_epi16(words, words);
+    lanes[0] = _mm_unpacklo_epi32(low, low);
+    lanes[1] = _mm_unpackhi_epi32(low, low);
+    lanes[2] = _mm_unpacklo_epi32(high, high);
+    lanes[3] = _mm_unpackhi_epi32(high, high);
+}
+
+inline __m128i loadFlags8(const quint8 *flags)
+{
+    return _mm_loadl_epi64(reinterpret_cast<const __m128i *>(flags));
+}
+
+inline qint64 horizontalSum(__m128i total)
+{
+    qint64 lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), total);
+    return lanes[0] + lanes[1];
+}
+
+size_t netAmountsSse2(const qint64 *amounts, const quint8 *income, const quint8 *withheld, const double *percents,
+                      size_t count, qint64 *net, qint64 *signedNet)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t clamped = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i expense = _mm_cmpeq_epi8(loadFlags8(income + i), zero);
+        const __m128i untaxed = _mm_or_si128(expense, _mm_cmpeq_epi8(loadFlags8(withheld + i), zero));
+        if ((_mm_movemask_epi8(untaxed) & 0xFF) != 0xFF) {
+            // Some income has tax withheld; percentages need the exact integer rounding
+            clamped += netAmountsScalar(amounts + i, income + i, withheld + i, percents + i, 8, net + i, signedNet + i);
+            continue;
+        }
+        __m128i masks[4];
+        widenMask(expense, masks);
+        for (int k = 0; k < 4; ++k) {
+            const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(amounts + i + 2 * k));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(net + i + 2 * k), value);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(signedNet + i + 2 * k),
+                             _mm_sub_epi64(_mm_xor_si128(value, masks[k]), masks[k]));
+        }
+    }
+    return clamped + netAmountsScalar(amounts + i, income + i, withheld + i, percents + i, count - i, net + i,
+                                      signedNet + i);
+}
+
+qint64 sumSse2(const qint64 *values, size_t count)
+{
+    __m128i total0 = _mm_setzero_si128();
+    __m128i total1 = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        total0 = _mm_add_epi64(total0, _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i)));
+        total1 = _mm_add_epi64(total1, _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i + 2)));
+    }
+    return horizontalSum(_mm_add_epi64(total0, total1)) + sumScalar(values + i, count - i);
+}
+
+qint64 signedSumSse2(const qint64 *values, const quint8 *credit, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i total = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i masks[4];
+        widenMask(_mm_cmpeq_epi8(loadFlags8(credit + i), zero), masks);
+        for (int k = 0; k < 4; ++k) {
+            const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i + 2 * k));
+            total = _mm_add_epi64(total, _mm_sub_epi64(_mm_xor_si128(value, masks[k]), masks[k]));
+        }
+    }
+    return horizontalSum(total) + signedSumScalar(values + i, credit + i, count - i);
+}
+
+qint64 maskedSumSse2(const qint64 *values, const quint8 *flags, quint8 wanted, const quint8 *removed, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i target = _mm_set1_epi8(static_cast<char>(wanted));
+    __m128i total = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i masks[4];
+        widenMask(_mm_and_si128(_mm_cmpeq_epi8(loadFlags8(flags + i), target),
+                                _mm_cmpeq_epi8(loadFlags8(removed + i), zero)),
+                  masks);
+        for (int k = 0; k < 4; ++k) {
+            const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i + 2 * k));
+            total = _mm_add_epi64(total, _mm_and_si128(value, masks[k]));
+        }
+    }
+    return horizontalSum(total) + maskedSumScalar(values + i, flags + i, wanted, removed + i, count - i);
+}
+
+// SSE2 has no gather, so gatherSum stays scalar at that level
+const KernelTable Sse2Kernels = {netAmountsSse2, sumSse2, signedSumSse2, maskedSumSse2, gatherSumScalar};
+
+// AVX2 kernels, eight elements per iteration in two vectors of four
+
+AVX2_FUNCTION inline void widenMask(__m128i bytes, __m256i lanes[2])
+{
+    lanes[0] = _mm256_cvtepi8_epi64(bytes);
+    lanes[1] = _mm256_cvtepi8_epi64(_mm_srli_si128(bytes, 4));
+}
+
+AVX2_FUNCTION inline qint64 horizontalSum(__m256i total)
+{
+    return horizontalSum(_mm_add_epi64(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1)));
+}
+
+AVX2_FUNCTION size_t netAmountsAvx2(const qint64 *amounts, const quint8 *income, const quint8 *withheld,
+                                    const double *percents, size_t count, qint64 *net, qint64 *signedNet)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t clamped = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i expense = _mm_cmpeq_epi8(loadFlags8(income + i), zero);
+        const __m128i untaxed = _mm_or_si128(expense, _mm_cmpeq_epi8(loadFlags8(withheld + i), zero));
+        if ((_mm_movemask_epi8(untaxed) & 0xFF) != 0xFF) {
+            clamped += netAmountsScalar(amounts + i, income + i, withheld + i, percents + i, 8, net + i, signedNet + i);
+            continue;
+        }
+        __m256i masks[2];
+        widenMask(expense, masks);
+        for (int k = 0; k < 2; ++k) {
+            const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(amounts + i + 4 * k));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(net + i + 4 * k), value);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(signedNet + i + 4 * k),
+                                _mm256_sub_epi64(_mm256_xor_si256(value, masks[k]), masks[k]));
+        }
+    }
+    return clamped + netAmountsScalar(amounts + i, income + i, withheld + i, percents + i, count - i, net + i,
+                                      signedNet + i);
+}
+
+AVX2_FUNCTION qint64 sumAvx2(const qint64 *values, size_t count)
+{
+    __m256i total0 = _mm256_setzero_si256();
+    __m256i total1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        total0 = _mm256_add_epi64(total0, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i)));
+        total1 = _mm256_add_epi64(total1, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i + 4)));
+    }
+    return horizontalSum(_mm256_add_epi64(total0, total1)) + sumScalar(values + i, count - i);
+}
+
+AVX2_FUNCTION qint64 signedSumAvx2(const qint64 *values, const quint8 *credit, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m256i total0 = _mm256_setzero_si256();
+    __m256i total1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i masks[2];
+        widenMask(_mm_cmpeq_epi8(loadFlags8(credit + i), zero), masks);
+        const __m256i value0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i));
+        const __m256i value1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i + 4));
+        total0 = _mm256_add_epi64(total0, _mm256_sub_epi64(_mm256_xor_si256(value0, masks[0]), masks[0]));
+        total1 = _mm256_add_epi64(total1, _mm256_sub_epi64(_mm256_xor_si256(value1, masks[1]), masks[1]));
+    }
+    return horizontalSum(_mm256_add_epi64(total0, total1)) + signedSumScalar(values + i, credit + i, count - i);
+}
+
+AVX2_FUNCTION qint64 maskedSumAvx2(const qint64 *values, const quint8 *flags, quint8 wanted, const quint8 *removed,
+                                   size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i target = _mm_set1_epi8(static_cast<char>(wanted));
+    __m256i total0 = _mm256_setzero_si256();
+    __m256i total1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i masks[2];
+        widenMask(_mm_and_si128(_mm_cmpeq_epi8(loadFlags8(flags + i), target),
+                                _mm_cmpeq_epi8(loadFlags8(removed + i), zero)),
+                  masks);
+        const __m256i value0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i));
+        const __m256i value1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i + 4));
+        total0 = _mm256_add_epi64(total0, _mm256_and_si256(value0, masks[0]));
+        total1 = _mm256_add_epi64(total1, _mm256_and_si256(value1, masks[1]));
+    }
+    return horizontalSum(_mm256_add_epi64(total0, total1))
+           + maskedSumScalar(values + i, flags + i, wanted, removed + i, count - i);
+}
+
+AVX2_FUNCTION qint64 gatherSumAvx2(const qint64 *values, const quint32 *positions, size_t count)
+{
+    const long long *base = reinterpret_cast<const long long *>(values);
+    __m256i total0 = _mm256_setzero_si256();
+    __m256i total1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // Positions are below 2^31, so they can serve as signed 32-bit gather indexes
+        const __m128i index0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(positions + i));
+        const __m128i index1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(positions + i + 4));
+        total0 = _mm256_add_epi64(total0, _mm256_i32gather_epi64(base, index0, 8));
+        total1 = _mm256_add_epi64(total1, _mm256_i32gather_epi64(base, index1, 8));
+    }
+    return horizontalSum(_mm256_add_epi64(total0, total1)) + gatherSumScalar(values, positions + i, count - i);
+}
+
+const KernelTable Avx2Kernels = {netAmountsAvx2, sumAvx2, signedSumAvx2, maskedSumAvx2, gatherSumAvx2};
+
+bool cpuHasAvx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    // AVX2 needs the CPUID bit and the OS saving the YMM registers (XCR0 bits 1 and 2)
+    int info[4];
+    __cpuid(info, 1);
+    const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // AMOUNTKERNELS_X86
+
+std::atomic<int> activeLevel(-1); // -1 until the first kernel picks supportedLevel()
+
+const KernelTable &kernels()
+{
+    switch (AmountKernels::level()) {
+#ifdef AMOUNTKERNELS_X86
+    case AmountKernels::Avx2:
+        return Avx2Kernels;
+    case AmountKernels::Sse2:
+        return Sse2Kernels;
+#endif
+    default:
+        return ScalarKernels;
+    }
+}
+
+} // namespace
+
+AmountKernels::Level AmountKernels::level()
+{
+    int current = activeLevel.load(std::memory_order_relaxed);
+    if (current < 0) {
+        current = supportedLevel();
+        activeLevel.store(current, std::memory_order_relaxed);
+    }
+    return static_cast<Level>(current);
+}
+
+AmountKernels::Level AmountKernels::supportedLevel()
+{
+#ifdef AMOUNTKERNELS_X86
+    static const Level supported = cpuHasAvx2() ? Avx2 : Sse2;
+    return supported;
+#else
+    return Scalar;
+#endif
+}
+
+void AmountKernels::setLevel(Level level)
+{
+    activeLevel.store(level > supportedLevel() ? supportedLevel() : level, std::memory_order_relaxed);
+}
+
+const char *AmountKernels::levelName(Level level)
+{
+    switch (level) {
+    case Avx2:
+        return "AVX2";
+    case Sse2:
+        return "SSE2";
+    default:
+        return "scalar";
+    }
+}
+
+size_t AmountKernels::netAmounts(const Money *amounts, const quint8 *incomeFlags, const quint8 *taxWithheldFlags,
+                                 const double *taxPercents, std::size_t count, Money *net, Money *signedNet)
+{
+    return kernels().netAmounts(centsOf(amounts), incomeFlags, taxWithheldFlags, taxPercents, count, centsOf(net),
+                                centsOf(signedNet));
+}
+
+Money AmountKernels::sum(const Money *values, std::size_t count)
+{
+    return Money::fromCents(kernels().sum(centsOf(values), count));
+}
+
+Money AmountKernels::signedSum(const Money *values, const quint8 *credit, std::size_t count)
+{
+    return Money::fromCents(kernels().signedSum(centsOf(values), credit, count));
+}
+
+Money AmountKernels::maskedSum(const Money *values, const quint8 *flags, quint8 wanted, const quint8 *removedFlags,
+                               std::size_t count)
+{
+    return Money::fromCents(kernels().maskedSum(centsOf(values), flags, wanted, removedFlags, count));
+}
+
+Money AmountKernels::gatherSum(const Money *values, const quint32 *positions, std::size_t count)
+{
+    return Money::fromCents(kernels().gatherSum(centsOf(values), positions, count));
+}
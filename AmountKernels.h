@@ -0,0 +1,116 @@
+#ifndef AMOUNTKERNELS_H
+#define AMOUNTKERNELS_H
+
+#include <QtGlobal>
+#include <cstddef>
+#include "Money.h"
+
+/**
+ * @brief The AmountKernels class computes net amounts and totals over the Ledger's amount columns.
+ *
+ * Each kernel walks flat arrays once and has three implementations: a portable scalar loop,
+ * SSE2 (two amounts per instruction) and AVX2 (four amounts per instruction). The best one
+ * the processor supports is chosen the first time a kernel runs; all of them return exactly
+ * the same result, since amounts are integer cents and integer addition is associative.
+ *
+ * Flags are the Ledger's one-byte columns (0 or 1), so a mask is formed by comparing bytes
+ * and widening them to 64-bit lanes instead of branching per row.
+ */
+class AmountKernels {
+public:
+    /**
+     * @brief An instruction set the kernels can run on.
+     */
+    enum Level {
+        Scalar, ///< Plain C++, for any processor.
+        Sse2,   ///< 128-bit SSE2, the x86-64 baseline.
+        Avx2    ///< 256-bit AVX2, detected at run time.
+    };
+
+    /**
+     * @brief Retrieves the instruction set the kernels currently run on.
+     * @return The level.
+     */
+    static Level level();
+
+    /**
+     * @brief Retrieves the best instruction set supported by this build and processor.
+     * @return The level.
+     */
+    static Level supportedLevel();
+
+    /**
+     * @brief Selects the instruction set, e.g. to compare implementations in a benchmark.
+     * @param level The level; one above supportedLevel() selects supportedLevel() instead.
+     */
+    static void setLevel(Level level);
+
+    /**
+     * @brief Names a level, e.g. "AVX2".
+     * @param level The level.
+     * @return The name.
+     */
+    static const char *levelName(Level level);
+
+    /**
+     * @brief Computes the net and signed net amounts of a block of transactions.
+     *
+     * Gives the same amounts as Transaction::calculateNetAmount(), but counts out-of-range
+     * tax percentages instead of warning per row. Rows without withheld income tax, the
+     * vast majority, are handled a vector at a time; the others are computed one by one.
+     *
+     * @param amounts The gross amounts.
+     * @param incomeFlags 1 for income, 0 for expenses.
+     * @param taxWithheldFlags 1 if tax was withheld.
+     * @param taxPercents The tax percentages.
+     * @param count The number of transactions.
+     * @param net Receives the amounts after withheld tax.
+     * @param signedNet Receives the net amounts, negated for expenses.
+     * @return The number of percentages outside 0-100 that were clamped.
+     */
+    static size_t netAmounts(const Money *amounts, const quint8 *incomeFlags, const quint8 *taxWithheldFlags,
+                             const double *taxPercents, std::size_t count, Money *net, Money *signedNet);
+
+    /**
+     * @brief Sums a contiguous array of amounts.
+     * @param values The amounts.
+     * @param count The number of amounts.
+     * @return The total.
+     */
+    static Money sum(const Money *values, std::size_t count);
+
+    /**
+     * @brief Sums amounts with a sign chosen per element: added where credit is non-zero, subtracted otherwise.
+     * @param values The amounts.
+     * @param credit One flag per amount, 1 for income and 0 for expenses.
+     * @param count The number of amounts.
+     * @return The net total.
+     */
+    static Money signedSum(const Money *values, const quint8 *credit, std::size_t count);
+
+    /**
+     * @brief Sums the amounts whose flag has a value and that are not removed.
+     * @param values The amounts.
+     * @param flags One flag per amount.
+     * @param wanted The flag value of the amounts to add.
+     * @param removedFlags One flag per amount, non-zero to skip it.
+     * @param count The number of amounts.
+     * @return The total of the selected amounts.
+     */
+    static Money maskedSum(const Money *values, const quint8 *flags, quint8 wanted, const quint8 *removedFlags,
+                           std::size_t count);
+
+    /**
+     * @brief Sums the amounts at a list of positions.
+     *
+     * Uses AVX2 gathers; SSE2 has no gather instruction, so that level runs the scalar loop.
+     *
+     * @param values The amounts.
+     * @param positions Indexes into values, each below 2^31.
+     * @param count The number of positions.
+     * @return The total.
+     */
+    static Money gatherSum(const Money *values, const quint32 *positions, std::size_t count);
+};
+
+#endif // AMOUNTKERNELS_H
@@ -0,0 +1,137 @@
+#include "BalanceIndex.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+const qint64 MinimumSlack = 1; // Blocks added beyond a new extreme when the range grows
+
+inline size_t lowestBit(size_t i)
+{
+    return i & (~i + 1);
+}
+
+} // namespace
+
+void BalanceIndex::add(int day, Money amount)
+{
+    const qint64 block = blockOf(day);
+    cover(block);
+    const size_t index = static_cast<size_t>(block - firstBlock);
+    blockTotals[index] += amount;
+    update(tree, index, amount);
+
+    std::vector<Money> &dayTree = dayTrees[index];
+    if (dayTree.empty()) {
+        dayTree.assign(BlockSize + 1, Money());
+        ++dayTreeCount;
+    }
+    update(dayTree, static_cast<size_t>(static_cast<qint64>(day) - block * static_cast<qint64>(BlockSize)), amount);
+}
+
+Money BalanceIndex::sumThrough(int day) const
+{
+    const qint64 block = blockOf(day);
+    if (blockTotals.empty() || block < firstBlock) {
+        return Money();
+    }
+    const size_t index = static_cast<size_t>(block - firstBlock);
+    if (index >= blockTotals.size()) {
+        return prefix(tree, blockTotals.size());
+    }
+
+    // Every earlier block whole, then this block's days through the day
+    Money sum = prefix(tree, index);
+    const std::vector<Money> &dayTree = dayTrees[index];
+    if (!dayTree.empty()) {
+        sum += prefix(dayTree, static_cast<size_t>(static_cast<qint64>(day) - block * static_cast<qint64>(BlockSize)) + 1);
+    }
+    return sum;
+}
+
+Money BalanceIndex::sumBetween(int fromDay, int toDay) const
+{
+    if (toDay < fromDay) {
+        return Money();
+    }
+    // fromDay - 1 cannot underflow: MinDay is one above the smallest int
+    return sumThrough(toDay) - sumThrough(fromDay - 1);
+}
+
+size_t BalanceIndex::memoryUsage() const
+{
+    return (blockTotals.capacity() + tree.capacity() + dayTreeCount * (BlockSize + 1)) * sizeof(Money)
+           + dayTrees.capacity() * sizeof(std::vector<Money>);
+}
+
+void BalanceIndex::clear()
+{
+    firstBlock = 0;
+    blockTotals.clear();
+    tree.clear();
+    dayTrees.clear();
+    dayTreeCount = 0;
+}
+
+qint64 BalanceIndex::blockOf(int day)
+{
+    const qint64 blockSize = static_cast<qint64>(BlockSize);
+    return day >= 0 ? day / blockSize : (static_cast<qint64>(day) - blockSize + 1) / blockSize;
+}
+
+void BalanceIndex::cover(qint64 block)
+{
+    const qint64 first = firstBlock;
+    const qint64 end = first + static_cast<qint64>(blockTotals.size());
+    if (!blockTotals.empty() && block >= first && block < end) {
+        return;
+    }
+
+    qint64 newFirst = block;
+    qint64 newEnd = block + 1;
+    if (!blockTotals.empty()) {
+        // Grow by at least the current size on the side that overflowed, so loads stay amortised O(log b)
+        const qint64 slack = std::max<qint64>(MinimumSlack, end - first);
+        newFirst = block < first ? std::max(block - slack, blockOf(std::numeric_limits<int>::min() + 1)) : first;
+        newEnd = block >= end ? std::min(block + slack, blockOf(std::numeric_limits<int>::max())) + 1 : end;
+    } else {
+        newEnd = std::min(block + MinimumSlack, blockOf(std::numeric_limits<int>::max())) + 1;
+    }
+
+    const size_t offset = static_cast<size_t>(first - newFirst);
+    std::vector<Money> newTotals(static_cast<size_t>(newEnd - newFirst));
+    std::vector<std::vector<Money>> newDayTrees(newTotals.size());
+    for (size_t i = 0; i < blockTotals.size(); ++i) {
+        newTotals[offset + i] = blockTotals[i];
+        newDayTrees[offset + i].swap(dayTrees[i]);
+    }
+    blockTotals.swap(newTotals);
+    dayTrees.swap(newDayTrees);
+    firstBlock = newFirst;
+
+    // Linear-time construction: each node passes its sum to its parent
+    tree.assign(blockTotals.size() + 1, Money());
+    for (size_t i = 1; i < tree.size(); ++i) {
+        tree[i] += blockTotals[i - 1];
+        const size_t parent = i + lowestBit(i);
+        if (parent < tree.size()) {
+            tree[parent] += tree[i];
+        }
+    }
+}
+
+Money BalanceIndex::prefix(const std::vector<Money> &fenwick, size_t count)
+{
+    Money sum;
+    for (size_t i = count; i > 0; i -= lowestBit(i)) {
+        sum += fenwick[i];
+    }
+    return sum;
+}
+
+void BalanceIndex::update(std::vector<Money> &fenwick, size_t index, Money amount)
+{
+    for (size_t i = index + 1; i < fenwick.size(); i += lowestBit(i)) {
+        fenwick[i] += amount;
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef BALANCEINDEX_H
+#define BALANCEINDEX_H
+
+#include <vector>
+#include "Money.h"
+
+/**
+ * @brief The BalanceIndex class answers "sum of all amounts up to a day" in logarithmic time.
+ *
+ * Days are grouped into blocks of BlockSize consecutive days. Amounts are accumulated per
+ * block in a Fenwick (binary indexed) tree over the blocks, and per day in a Fenwick tree
+ * over the days of their block. Adding an amount on any day, including one before every
+ * other, and querying the sum through a day both take O(log b + log BlockSize), where b is
+ * the number of blocks between the earliest and the latest day seen.
+ *
+ * Only blocks that hold an amount get a per-day tree, so memory grows with the number of
+ * distinct blocks used plus a few words per block of the span: a ledger with one row in
+ * year 0000 and the rest in 2024 holds tens of kilobytes, not a tree over every day between.
+ * The block range grows as needed; growing rebuilds the block tree in O(b), and the range is
+ * extended with slack so a ledger loaded in date order rebuilds O(log b) times.
+ */
+class BalanceIndex {
+public:
+    /**
+     * @brief Adds an amount to a day.
+     * @param day The day number.
+     * @param amount The amount; negative to subtract.
+     */
+    void add(int day, Money amount);
+
+    /**
+     * @brief Sums the amounts of every day up to and including a day.
+     * @param day The last day included; DateUtil::MinDay and MaxDay are allowed.
+     * @return The sum.
+     */
+    Money sumThrough(int day) const;
+
+    /**
+     * @brief Sums the amounts of the days in an inclusive range.
+     * @param fromDay The first day included.
+     * @param toDay The last day included.
+     * @return The sum, or zero if toDay is before fromDay.
+     */
+    Money sumBetween(int fromDay, int toDay) const;
+
+    /**
+     * @brief Removes all amounts.
+     */
+    void clear();
+
+    /**
+     * @brief Estimates the heap memory held by the index.
+     * @return The size in bytes.
+     */
+    size_t memoryUsage() const;
+
+private:
+    static constexpr int BlockBits = 10;                       ///< Days per block, as a power of two.
+    static constexpr size_t BlockSize = size_t(1) << BlockBits; ///< Days per block.
+
+    /**
+     * @brief Retrieves the block a day belongs to, rounding towards negative infinity.
+     * @param day The day number.
+     * @return The block number.
+     */
+    static qint64 blockOf(int day);
+
+    /**
+     * @brief Rebuilds the block tree over a range that covers a block and the current range.
+     * @param block The block that must be covered.
+     */
+    void cover(qint64 block);
+
+    /**
+     * @brief Sums the first count entries of a Fenwick tree.
+     * @param fenwick The one-based tree.
+     * @param count The number of leading entries, at most the tree size minus one.
+     * @return The sum.
+     */
+    static Money prefix(const std::vector<Money> &fenwick, size_t count);
+
+    /**
+     * @brief Adds an amount to an entry of a Fenwick tree.
+     * @param fenwick The one-based tree.
+     * @param index The zero-based entry.
+     * @param amount The amount.
+     */
+    static void update(std::vector<Money> &fenwick, size_t index, Money amount);
+
+    qint64 firstBlock = 0;                    ///< Block number of the first covered block.
+    std::vector<Money> blockTotals;           ///< Total per covered block, used to rebuild the tree.
+    std::vector<Money> tree;                  ///< Fenwick tree over blockTotals, one-based.
+    std::vector<std::vector<Money>> dayTrees; ///< Fenwick tree over the days of each covered block; empty until used.
+    size_t dayTreeCount = 0;                  ///< Number of non-empty dayTrees.
+};
+
+#endif // BALANCEINDEX_H
@@ -0,0 +1,24 @@
+#include "Categories.h"
+#include "StringInterner.h"
+
+const QStringList &Categories::predefined()
+{
+    static const QStringList categories = [] {
+        const QStringList names = {
+            "Pay",
+            "Groceries",
+            "Rent",
+            "Utilities",
+            "Transportation",
+            "Entertainment",
+            "Healthcare",
+            "Education",
+            "Savings"
+        };
+        for (const QString &name : names) {
+            StringInterner::intern(name.toStdString());
+        }
+        return names;
+    }();
+    return categories;
+}
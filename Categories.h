@@ -0,0 +1,21 @@
+#ifndef CATEGORIES_H
+#define CATEGORIES_H
+
+#include <QStringList>
+
+/**
+ * @brief The Categories class lists the categories offered when adding and filtering transactions.
+ */
+class Categories {
+public:
+    /**
+     * @brief Retrieves the predefined categories, in display order.
+     *
+     * The names are interned on first use, so filters comparing against them never add strings.
+     *
+     * @return The category names.
+     */
+    static const QStringList &predefined();
+};
+
+#endif // CATEGORIES_H
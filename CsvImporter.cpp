@@ -0,0 +1,330 @@
+#include "CsvImporter.h"
+#include "Database.h"
+#include "DateUtil.h"
+#include "Money.h"
+#include <QFile>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlError>
+
+CsvImporter::CsvImporter(int userId, QObject *parent)
+    : QObject(parent)
+    , userId(userId)
+    , cancelRequested(false)
+{
+    resetState();
+}
+
+void CsvImporter::cancel()
+{
+    cancelRequested = true;
+}
+
+void CsvImporter::resetState()
+{
+    for (int &index : columnIndex) {
+        index = -1;
+    }
+    headerParsed = false;
+    recordNumber = 0;
+    batch.clear();
+    batch.reserve(BatchSize);
+    record.clear();
+    field.clear();
+    inQuotes = false;
+    quoteSeen = false;
+    fieldTooLong = false;
+    result = Result();
+}
+
+CsvImporter::Result CsvImporter::importFile(QSqlDatabase &db, const QString &path)
+{
+    resetState();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.error = "Failed to open " + path + ": " + file.errorString();
+        return result;
+    }
+
+    // Relax syncing for the duration of the load; the previous pragmas return when this goes out of scope
+    ScopedStorageProfile bulkProfile(db, StorageProfile::BulkImport);
+
+    // One enclosing transaction makes the import all-or-nothing; the batches are written into it
+    if (!db.transaction()) {
+        result.error = "Failed to start import transaction: " + db.lastError().text();
+        return result;
+    }
+
+    database = db;
+    const qint64 totalBytes = file.size();
+    qint64 bytesRead = 0;
+    QByteArray chunk(static_cast<int>(ChunkSize), Qt::Uninitialized);
+
+    while (result.error.isEmpty()) {
+        if (cancelRequested) {
+            result.cancelled = true;
+            break;
+        }
+
+        qint64 n = file.read(chunk.data(), ChunkSize);
+        if (n < 0) {
+            result.error = "Failed to read " + path + ": " + file.errorString();
+            break;
+        }
+        if (n == 0) {
+            finish();
+            break;
+        }
+
+        feed(chunk.constData(), n);
+        bytesRead += n;
+        emit progress(bytesRead, totalBytes);
+    }
+
+    if (result.error.isEmpty() && !result.cancelled) {
+        flushBatch();
+        if (!headerParsed) {
+            result.error = "The file is empty.";
+        }
+    }
+
+    if (!result.error.isEmpty() || result.cancelled) {
+        db.rollback();
+        result.rowsImported = 0;
+    } else if (!db.commit()) {
+        result.error = "Failed to commit import: " + db.lastError().text();
+        db.rollback();
+        result.rowsImported = 0;
+    }
+
+    database = QSqlDatabase();
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
+
+void CsvImporter::feed(const char *data, qint64 size)
+{
+    for (qint64 i = 0; i < size && result.error.isEmpty(); ++i) {
+        const char c = data[i];
+
+        if (inQuotes) {
+            if (quoteSeen) {
+                quoteSeen = false;
+                if (c == '"') {
+                    // "" inside a quoted field is an escaped quote
+                    field.append('"');
+                    continue;
+                }
+                // The previous quote closed the field; handle c as unquoted text
+                inQuotes = false;
+            } else {
+                if (c == '"') {
+                    quoteSeen = true;
+                } else if (field.size() < MaxFieldLength) {
+                    field.append(c);
+                } else {
+                    fieldTooLong = true;
+                }
+                continue;
+            }
+        }
+
+        if (c == ',') {
+            endField();
+        } else if (c == '\n') {
+            endField();
+            endRecord();
+        } else if (c == '\r') {
+            continue;
+        } else if (c == '"' && field.isEmpty()) {
+            inQuotes = true;
+        } else if (field.size() < MaxFieldLength) {
+            field.append(c);
+        } else {
+            fieldTooLong = true;
+        }
+    }
+}
+
+void CsvImporter::finish()
+{
+    inQuotes = false;
+    quoteSeen = false;
+    if (!field.isEmpty() || !record.empty()) {
+        endField();
+        endRecord();
+    }
+}
+
+void CsvImporter::endField()
+{
+    record.push_back(field);
+    field.clear();
+}
+
+void CsvImporter::endRecord()
+{
+    ++recordNumber;
+
+    // Skip blank lines
+    bool blank = record.size() == 1 && record.front().trimmed().isEmpty();
+    if (blank) {
+        record.clear();
+        return;
+    }
+
+    if (!headerParsed) {
+        if (mapHeader()) {
+            headerParsed = true;
+        }
+        record.clear();
+        return;
+    }
+
+    ++result.rowsRead;
+
+    Transaction::NewRow row;
+    QString reason;
+    if (fieldTooLong) {
+        reason = QString("Field longer than %1 bytes.").arg(MaxFieldLength);
+    }
+
+    if (reason.isEmpty() && parseRecord(row, reason)) {
+        batch.push_back(std::move(row));
+        if (static_cast<int>(batch.size()) >= BatchSize) {
+            flushBatch();
+        }
+    } else {
+        ++result.rowsRejected;
+        emit rowRejected(recordNumber, reason);
+    }
+
+    record.clear();
+    fieldTooLong = false;
+}
+
+bool CsvImporter::mapHeader()
+{
+    for (int i = 0; i < static_cast<int>(record.size()); ++i) {
+        QByteArray rawName = record[i];
+        if (i == 0 && rawName.startsWith("\xEF\xBB\xBF")) {
+            rawName.remove(0, 3); // UTF-8 byte order mark
+        }
+        const QString name = QString::fromUtf8(rawName).trimmed().toLower();
+
+        if (name == "date") {
+            columnIndex[DateColumn] = i;
+        } else if (name == "category") {
+            columnIndex[CategoryColumn] = i;
+        } else if (name == "subcategory" || name == "description" || name == "memo") {
+            columnIndex[SubcategoryColumn] = i;
+        } else if (name == "amount") {
+            columnIndex[AmountColumn] = i;
+        } else if (name == "type") {
+            columnIndex[TypeColumn] = i;
+        } else if (name == "tax" || name == "taxamount") {
+            columnIndex[TaxColumn] = i;
+        }
+    }
+
+    if (columnIndex[DateColumn] < 0 || columnIndex[CategoryColumn] < 0 || columnIndex[AmountColumn] < 0) {
+        result.error = "The header must contain date, category and amount columns.";
+        return false;
+    }
+    return true;
+}
+
+QString CsvImporter::fieldText(Column column) const
+{
+    int index = columnIndex[column];
+    if (index < 0 || index >= static_cast<int>(record.size())) {
+        return QString();
+    }
+    return QString::fromUtf8(record[index]).trimmed();
+}
+
+bool CsvImporter::parseRecord(Transaction::NewRow &row, QString &reason) const
+{
+    const QString date = fieldText(DateColumn);
+    const int day = DateUtil::parse(date);
+    if (day == DateUtil::InvalidDay) {
+        reason = "Invalid date \"" + date + "\", expected yyyy-MM-dd.";
+        return false;
+    }
+
+    const QString category = fieldText(CategoryColumn);
+    if (category.isEmpty()) {
+        reason = "Missing category.";
+        return false;
+    }
+
+    // Accept "$1,234.56" and "(12.00)" style amounts as exported by banks
+    bool ok = false;
+    Money amount = Money::parse(fieldText(AmountColumn), &ok);
+    if (!ok) {
+        reason = "Invalid amount \"" + fieldText(AmountColumn) + "\".";
+        return false;
+    }
+
+    QString type;
+    const QString typeText = fieldText(TypeColumn).toLower();
+    if (typeText.isEmpty()) {
+        type = amount.isNegative() ? "Expense" : "Income";
+    } else if (typeText == "income" || typeText == "credit") {
+        type = "Income";
+    } else if (typeText == "expense" || typeText == "debit") {
+        type = "Expense";
+    } else {
+        reason = "Invalid type \"" + fieldText(TypeColumn) + "\", expected Income or Expense.";
+        return false;
+    }
+
+    if (amount.isNegative()) {
+        amount = -amount;
+    }
+    if (amount.isZero()) {
+        reason = "Amount must be greater than zero.";
+        return false;
+    }
+
+    double tax = 0.0;
+    const QString taxText = fieldText(TaxColumn);
+    if (!taxText.isEmpty()) {
+        tax = taxText.toDouble(&ok);
+        if (!ok || tax < 0.0 || tax > 100.0) {
+            reason = "Invalid tax percentage \"" + taxText + "\".";
+            return false;
+        }
+    }
+    bool taxWithheld = type == "Income" && tax > 0.0;
+
+    row.userId = userId;
+    row.day = day;
+    row.category = category;
+    row.subcategory = fieldText(SubcategoryColumn);
+    row.amount = amount;
+    row.type = type;
+    row.taxWithheld = taxWithheld;
+    row.taxAmount = taxWithheld ? tax : 0.0;
+    return true;
+}
+
+void CsvImporter::flushBatch()
+{
+    if (batch.empty()) {
+        return;
+    }
+
+    for (int id : Transaction::writeRowsInTransaction(database, batch)) {
+        if (id > 0) {
+            ++result.rowsImported;
+        } else {
+            ++result.rowsRejected;
+        }
+    }
+    batch.clear();
+}
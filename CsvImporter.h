@@ -0,0 +1,162 @@
+#ifndef CSVIMPORTER_H
+#define CSVIMPORTER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <QSqlDatabase>
+#include <atomic>
+#include <vector>
+#include "Transaction.h"
+
+/**
+ * @brief The CsvImporter class streams a CSV bank statement into the transactions table.
+ *
+ * The file is read in fixed-size chunks and parsed by an incremental state machine, so only
+ * one chunk, one record and one insert batch are held in memory regardless of file size.
+ * Valid rows are written with Transaction::writeRowsInTransaction inside a single database
+ * transaction, which is rolled back if the import is cancelled or fails. Rows keep their own
+ * strings, so an import does not grow the process-wide StringInterner. The connection runs
+ * under StorageProfile::BulkImport while the import is in progress.
+ *
+ * The first record must be a header naming the columns. Recognized names (case-insensitive)
+ * are date, category, subcategory (or description/memo), amount, type and tax. Date, category
+ * and amount are required. Without a type column, negative amounts are imported as expenses
+ * and positive amounts as income.
+ */
+class CsvImporter : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Summary of a finished import.
+     */
+    struct Result {
+        qint64 rowsRead = 0;     ///< Data records read, excluding the header.
+        qint64 rowsImported = 0; ///< Records written to the database.
+        qint64 rowsRejected = 0; ///< Records skipped because they failed validation or insertion.
+        qint64 elapsedMs = 0;    ///< Wall-clock duration of the import.
+        bool cancelled = false;  ///< True if cancel() stopped the import; nothing was written.
+        QString error;           ///< Non-empty if the import failed; nothing was written.
+    };
+
+    static constexpr qint64 ChunkSize = 64 * 1024; ///< Bytes read from the file per step.
+    static constexpr int BatchSize = 1000;         ///< Rows handed to writeRowsInTransaction at once.
+    static constexpr int MaxFieldLength = 4096;    ///< Longest accepted field, bounding memory on malformed input.
+
+    /**
+     * @brief Constructs an importer that assigns every imported row to the given user.
+     * @param userId The user who owns the imported transactions.
+     * @param parent The parent QObject.
+     */
+    explicit CsvImporter(int userId, QObject *parent = nullptr);
+
+    /**
+     * @brief Imports a CSV file synchronously, emitting progress after every chunk.
+     *
+     * Runs on whichever thread owns the connection, e.g. as a DatabaseService job; progress
+     * and rowRejected are then delivered to GUI receivers through queued connections.
+     *
+     * @param db The connection to import into.
+     * @param path The CSV file to import.
+     * @return A summary of the import.
+     */
+    Result importFile(QSqlDatabase &db, const QString &path);
+
+public slots:
+    /**
+     * @brief Requests that the import stops after the current chunk. Safe to call from any thread,
+     * including before importFile() has started.
+     */
+    void cancel();
+
+signals:
+    /**
+     * @brief Emitted after each chunk has been parsed.
+     * @param bytesRead Bytes consumed so far.
+     * @param totalBytes Size of the file.
+     */
+    void progress(qint64 bytesRead, qint64 totalBytes);
+
+    /**
+     * @brief Emitted for each record that is skipped.
+     * @param recordNumber The 1-based record number in the file (the header is record 1).
+     * @param reason Why the record was rejected.
+     */
+    void rowRejected(qint64 recordNumber, const QString &reason);
+
+private:
+    /**
+     * @brief Transaction fields that can be mapped to CSV columns.
+     */
+    enum Column { DateColumn, CategoryColumn, SubcategoryColumn, AmountColumn, TypeColumn, TaxColumn, ColumnCount };
+
+    int userId; ///< Owner of the imported transactions.
+    std::atomic<bool> cancelRequested; ///< Set by cancel(), polled between chunks.
+    int columnIndex[ColumnCount]; ///< CSV column of each field, or -1 if absent.
+    bool headerParsed; ///< True once the header record has been mapped.
+    qint64 recordNumber; ///< Number of records seen so far, including the header.
+    std::vector<Transaction::NewRow> batch; ///< Parsed rows waiting to be inserted.
+    std::vector<QByteArray> record; ///< Fields of the record being parsed.
+    QByteArray field; ///< Bytes of the field being parsed.
+    bool inQuotes; ///< True while inside a quoted field.
+    bool quoteSeen; ///< True if the previous byte was a quote inside a quoted field.
+    bool fieldTooLong; ///< True if the current record has a field over MaxFieldLength.
+    Result result; ///< Summary of the running import.
+    QSqlDatabase database; ///< Connection of the running import.
+
+    /**
+     * @brief Clears all parser state before a new import.
+     */
+    void resetState();
+
+    /**
+     * @brief Runs the CSV state machine over a block of bytes.
+     * @param data The bytes to parse.
+     * @param size Number of bytes.
+     */
+    void feed(const char *data, qint64 size);
+
+    /**
+     * @brief Completes a record left open at the end of the file.
+     */
+    void finish();
+
+    /**
+     * @brief Moves the current field into the current record.
+     */
+    void endField();
+
+    /**
+     * @brief Handles a complete record as either the header or a data row.
+     */
+    void endRecord();
+
+    /**
+     * @brief Maps the header record to columnIndex.
+     * @return true if all required columns were found, false otherwise.
+     */
+    bool mapHeader();
+
+    /**
+     * @brief Validates the current record and converts it to a row to insert.
+     * @param row Receives the parsed row.
+     * @param reason Receives the rejection reason if the record is invalid.
+     * @return true if the record is valid, false otherwise.
+     */
+    bool parseRecord(Transaction::NewRow &row, QString &reason) const;
+
+    /**
+     * @brief Retrieves a trimmed field of the current record.
+     * @param column The field to retrieve.
+     * @return The field text, or an empty string if the column is absent.
+     */
+    QString fieldText(Column column) const;
+
+    /**
+     * @brief Inserts the pending batch and updates the counters.
+     */
+    void flushBatch();
+};
+
+#endif // CSVIMPORTER_H
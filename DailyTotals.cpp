@@ -0,0 +1,73 @@
+#include "DailyTotals.h"
+#include "StatementCache.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QDebug>
+
+QString DailyTotals::netCentsSql(const QString &row)
+{
+    // Same arithmetic as Money::percentage(): basis points, then half away from zero;
+    // SQLite's integer division truncates toward zero like C++.
+    const QString basisPoints = QString("CAST(ROUND(%1taxAmount * 100) AS INTEGER)").arg(row);
+    const QString product = QString("%1amountCents * %2").arg(row, basisPoints);
+    return QString("CASE WHEN %1type = 'Income' AND %1taxWithheld THEN "
+                   "CASE WHEN %1taxAmount < 0 THEN %1amountCents "
+                   "WHEN %1taxAmount > 100 THEN 0 "
+                   "ELSE %1amountCents - (%2 + CASE WHEN %2 < 0 THEN -5000 ELSE 5000 END) / 10000 END "
+                   "ELSE %1amountCents END")
+        .arg(row, product);
+}
+
+bool DailyTotals::rebuild(QSqlDatabase &db, QString &error)
+{
+    QSqlQuery query(db);
+    if (!query.exec("DELETE FROM daily_totals")
+        || !query.exec("INSERT INTO daily_totals (userId, day, category, type, netCents, transactionCount) "
+                       "SELECT userId, day, category, type, SUM(" + netCentsSql() + "), COUNT(*) "
+                       "FROM transactions GROUP BY userId, day, category, type")) {
+        error = query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+int DailyTotals::verify(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    const QString expected = "SELECT userId, day, category, type, SUM(" + netCentsSql() + ") AS netCents, "
+                             "COUNT(*) AS transactionCount FROM transactions GROUP BY userId, day, category, type";
+    const QString stored = "SELECT userId, day, category, type, netCents, transactionCount FROM daily_totals";
+
+    // Rows in either set but not the other; a changed group shows up once on each side
+    if (!query.exec("SELECT (SELECT COUNT(*) FROM (" + stored + " EXCEPT " + expected + ")) "
+                    "+ (SELECT COUNT(*) FROM (" + expected + " EXCEPT " + stored + "))")
+        || !query.next()) {
+        qCritical() << "Failed to verify daily totals:" << query.lastError().text();
+        return -1;
+    }
+    return query.value(0).toInt();
+}
+
+bool DailyTotals::readForUser(QSqlDatabase &db, int userId, std::vector<Row> &rows)
+{
+    StatementCache &cache = StatementCache::forDatabase(db);
+    QSqlQuery &query = cache.prepare("SELECT day, category, type, netCents, transactionCount "
+                                     "FROM daily_totals WHERE userId = :userId ORDER BY day, category, type");
+    query.bindValue(":userId", userId);
+    if (!cache.exec(query)) {
+        qCritical() << "Failed to read daily totals:" << query.lastError().text();
+        return false;
+    }
+
+    rows.clear();
+    while (query.next()) {
+        rows.push_back({query.value(0).toInt(),
+                        query.value(1).toString(),
+                        query.value(2).toString(),
+                        Money::fromCents(query.value(3).toLongLong()),
+                        query.value(4).toInt()});
+    }
+    query.finish();
+    return true;
+}
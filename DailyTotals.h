@@ -0,0 +1,70 @@
+#ifndef DAILYTOTALS_H
+#define DAILYTOTALS_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <vector>
+#include "Money.h"
+
+/**
+ * @brief The DailyTotals class reads and maintains the daily_totals rollup table.
+ *
+ * daily_totals holds one row per (userId, day, category, type) with the sum of the
+ * transactions' net amounts and their count. Triggers on the transactions table keep it
+ * current on every insert, update and delete, so charts and summaries can read a few
+ * hundred aggregate rows instead of the full history.
+ */
+class DailyTotals {
+public:
+    /**
+     * @brief One aggregate row of a user.
+     */
+    struct Row {
+        int day;          ///< Day number (days since 1970-01-01).
+        QString category; ///< Transaction category.
+        QString type;     ///< Transaction type ("Income" or "Expense").
+        Money net;        ///< Sum of Transaction::calculateNetAmount() over the group.
+        int count;        ///< Number of transactions in the group.
+    };
+
+    /**
+     * @brief Builds the SQL expression for a transaction's net amount in cents.
+     *
+     * Matches Transaction::calculateNetAmount() exactly: withheld tax on income is a
+     * percentage rounded half away from zero to the cent, clamped to 0-100%.
+     *
+     * @param row The row qualifier including the dot, e.g. "NEW." or "t.", or empty.
+     * @return The expression.
+     */
+    static QString netCentsSql(const QString &row = QString());
+
+    /**
+     * @brief Recomputes the whole table from the transactions table.
+     *
+     * Used as the one-time backfill when the table is created, and to repair it if
+     * verify() finds differences. Should run inside a transaction.
+     *
+     * @param db An open database connection.
+     * @param error Receives the failure description.
+     * @return true if the table was rebuilt, false otherwise.
+     */
+    static bool rebuild(QSqlDatabase &db, QString &error);
+
+    /**
+     * @brief Compares the table against totals computed from the transactions table.
+     * @param db An open database connection.
+     * @return The number of groups that are missing, extra or different, or -1 on error.
+     */
+    static int verify(QSqlDatabase &db);
+
+    /**
+     * @brief Reads all aggregate rows of a user.
+     * @param db An open database connection.
+     * @param userId The user whose rows are read.
+     * @param rows Receives the rows ordered by day, category and type.
+     * @return true if the rows were read, false otherwise.
+     */
+    static bool readForUser(QSqlDatabase &db, int userId, std::vector<Row> &rows);
+};
+
+#endif // DAILYTOTALS_H
@@ -0,0 +1,140 @@
+#include "Database.h"
+#include "SchemaMigrator.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QSettings>
+#include <QStringList>
+#include <QDebug>
+
+QString Database::defaultPath()
+{
+    return "app.db";
+}
+
+QSqlDatabase Database::open(const QString &path)
+{
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE");
+    db.setDatabaseName(path);
+    if (!db.open()) {
+        qCritical() << "Failed to open database:" << db.lastError().text();
+    }
+    return db;
+}
+
+bool Database::ensureSchema(QSqlDatabase &db)
+{
+    return SchemaMigrator::migrate(db);
+}
+
+StorageProfile Database::configuredStorageProfile()
+{
+    QSettings settings("Crumpet", "Unit13RA");
+    StorageProfile profile = StorageProfile::Balanced;
+    QString name = settings.value("storage/profile", storageProfileName(profile)).toString();
+    if (!storageProfileFromName(name, profile)) {
+        qWarning() << "Unknown storage profile" << name << "- using balanced";
+        profile = StorageProfile::Balanced;
+    }
+    return profile;
+}
+
+QString Database::storageProfileName(StorageProfile profile)
+{
+    switch (profile) {
+    case StorageProfile::Durable:
+        return "durable";
+    case StorageProfile::Balanced:
+        return "balanced";
+    case StorageProfile::BulkImport:
+        return "bulk-import";
+    }
+    return "balanced";
+}
+
+bool Database::storageProfileFromName(const QString &name, StorageProfile &profile)
+{
+    for (StorageProfile candidate : {StorageProfile::Durable, StorageProfile::Balanced, StorageProfile::BulkImport}) {
+        if (name.compare(storageProfileName(candidate), Qt::CaseInsensitive) == 0) {
+            profile = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+StoragePragmas Database::pragmasFor(StorageProfile profile)
+{
+    switch (profile) {
+    case StorageProfile::Durable:
+        return {"delete", 2, 0, -2000, 0};
+    case StorageProfile::Balanced:
+        return {"wal", 1, 256LL * 1024 * 1024, -64 * 1024, 2};
+    case StorageProfile::BulkImport:
+        return {"wal", 0, 256LL * 1024 * 1024, -256 * 1024, 2};
+    }
+    return pragmasFor(StorageProfile::Balanced);
+}
+
+StoragePragmas Database::currentPragmas(QSqlDatabase &db)
+{
+    StoragePragmas pragmas = pragmasFor(StorageProfile::Durable);
+    QSqlQuery query(db);
+
+    if (query.exec("PRAGMA journal_mode") && query.next())
+        pragmas.journalMode = query.value(0).toString().toLower();
+    if (query.exec("PRAGMA synchronous") && query.next())
+        pragmas.synchronous = query.value(0).toInt();
+    if (query.exec("PRAGMA mmap_size") && query.next())
+        pragmas.mmapSize = query.value(0).toLongLong();
+    if (query.exec("PRAGMA cache_size") && query.next())
+        pragmas.cacheSize = query.value(0).toInt();
+    if (query.exec("PRAGMA temp_store") && query.next())
+        pragmas.tempStore = query.value(0).toInt();
+
+    return pragmas;
+}
+
+bool Database::applyPragmas(QSqlDatabase &db, const StoragePragmas &pragmas)
+{
+    QSqlQuery query(db);
+    bool ok = true;
+
+    // journal_mode reports the mode actually in effect, which differs if the switch was refused
+    if (!query.exec("PRAGMA journal_mode=" + pragmas.journalMode) || !query.next()
+        || query.value(0).toString().compare(pragmas.journalMode, Qt::CaseInsensitive) != 0) {
+        qWarning() << "Failed to set journal_mode to" << pragmas.journalMode << ":" << query.lastError().text();
+        ok = false;
+    }
+
+    const QStringList statements = {
+        QString("PRAGMA synchronous=%1").arg(pragmas.synchronous),
+        QString("PRAGMA mmap_size=%1").arg(pragmas.mmapSize),
+        QString("PRAGMA cache_size=%1").arg(pragmas.cacheSize),
+        QString("PRAGMA temp_store=%1").arg(pragmas.tempStore)
+    };
+    for (const QString &statement : statements) {
+        if (!query.exec(statement)) {
+            qWarning() << "Failed to apply" << statement << ":" << query.lastError().text();
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+bool Database::applyStorageProfile(QSqlDatabase &db, StorageProfile profile)
+{
+    return applyPragmas(db, pragmasFor(profile));
+}
+
+ScopedStorageProfile::ScopedStorageProfile(QSqlDatabase db, StorageProfile profile)
+    : m_db(db)
+    , m_previous(Database::currentPragmas(m_db))
+{
+    Database::applyStorageProfile(m_db, profile);
+}
+
+ScopedStorageProfile::~ScopedStorageProfile()
+{
+    Database::applyPragmas(m_db, m_previous);
+}
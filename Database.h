@@ -0,0 +1,136 @@
+#ifndef DATABASE_H
+#define DATABASE_H
+
+#include <QSqlDatabase>
+#include <QString>
+
+/**
+ * @brief Named sets of SQLite pragmas trading durability for speed.
+ */
+enum class StorageProfile {
+    Durable,   ///< Rollback journal, synchronous=FULL: SQLite's defaults, safest against power loss.
+    Balanced,  ///< WAL, synchronous=NORMAL, memory-mapped reads and a large page cache.
+    BulkImport ///< WAL, synchronous=OFF and a very large cache, for the duration of large loads.
+};
+
+/**
+ * @brief The SQLite pragma values that make up a storage profile.
+ */
+struct StoragePragmas {
+    QString journalMode; ///< journal_mode, e.g. "delete" or "wal".
+    int synchronous;     ///< synchronous: 0 = OFF, 1 = NORMAL, 2 = FULL.
+    qint64 mmapSize;     ///< mmap_size in bytes; 0 disables memory-mapped I/O.
+    int cacheSize;       ///< cache_size; negative values are in KiB.
+    int tempStore;       ///< temp_store: 0 = DEFAULT, 1 = FILE, 2 = MEMORY.
+};
+
+/**
+ * @brief The Database class opens the application's SQLite database and creates its schema.
+ *
+ * It is shared by the GUI and the headless command-line tools so both see the same tables,
+ * indexes and storage settings.
+ */
+class Database {
+public:
+    /**
+     * @brief Retrieves the path of the application database file.
+     * @return The database file path.
+     */
+    static QString defaultPath();
+
+    /**
+     * @brief Opens the default connection to the given SQLite file.
+     * @param path The database file to open.
+     * @return The connection; check isOpen() and lastError() for the outcome.
+     */
+    static QSqlDatabase open(const QString &path = defaultPath());
+
+    /**
+     * @brief Brings the schema up to date by applying any pending SchemaMigrator steps.
+     * @param db An open database connection, not inside a transaction.
+     * @return true if the schema is current, false otherwise.
+     */
+    static bool ensureSchema(QSqlDatabase &db);
+
+    /**
+     * @brief Retrieves the storage profile selected in the application settings ("storage/profile").
+     * @return The configured profile, or StorageProfile::Balanced if none is set.
+     */
+    static StorageProfile configuredStorageProfile();
+
+    /**
+     * @brief Retrieves the settings name of a storage profile.
+     * @param profile The profile.
+     * @return "durable", "balanced" or "bulk-import".
+     */
+    static QString storageProfileName(StorageProfile profile);
+
+    /**
+     * @brief Parses a storage profile name as returned by storageProfileName().
+     * @param name The profile name.
+     * @param profile Receives the parsed profile.
+     * @return true if the name is known, false otherwise.
+     */
+    static bool storageProfileFromName(const QString &name, StorageProfile &profile);
+
+    /**
+     * @brief Retrieves the pragma values of a storage profile.
+     * @param profile The profile.
+     * @return The pragmas applied by applyStorageProfile().
+     */
+    static StoragePragmas pragmasFor(StorageProfile profile);
+
+    /**
+     * @brief Reads the pragma values currently in effect on a connection.
+     * @param db An open database connection.
+     * @return The current pragmas.
+     */
+    static StoragePragmas currentPragmas(QSqlDatabase &db);
+
+    /**
+     * @brief Applies pragma values to a connection. Must not be called inside a transaction.
+     * @param db An open database connection.
+     * @param pragmas The values to apply.
+     * @return true if every pragma was applied, false otherwise.
+     */
+    static bool applyPragmas(QSqlDatabase &db, const StoragePragmas &pragmas);
+
+    /**
+     * @brief Applies a named storage profile to a connection. Must not be called inside a transaction.
+     * @param db An open database connection.
+     * @param profile The profile to apply.
+     * @return true if every pragma was applied, false otherwise.
+     */
+    static bool applyStorageProfile(QSqlDatabase &db, StorageProfile profile);
+
+};
+
+/**
+ * @brief Switches a connection to another storage profile and restores the previous pragmas on destruction.
+ *
+ * Typically used to run a large load under StorageProfile::BulkImport. Create it before
+ * starting the load's transaction and let it go out of scope after committing.
+ */
+class ScopedStorageProfile {
+public:
+    /**
+     * @brief Saves the current pragmas of a connection and applies a profile.
+     * @param db An open database connection.
+     * @param profile The profile to use while this object exists.
+     */
+    ScopedStorageProfile(QSqlDatabase db, StorageProfile profile);
+
+    /**
+     * @brief Restores the pragmas that were in effect before construction.
+     */
+    ~ScopedStorageProfile();
+
+    ScopedStorageProfile(const ScopedStorageProfile &) = delete;
+    ScopedStorageProfile &operator=(const ScopedStorageProfile &) = delete;
+
+private:
+    QSqlDatabase m_db; ///< The connection whose pragmas were changed.
+    StoragePragmas m_previous; ///< Pragmas to restore.
+};
+
+#endif // DATABASE_H
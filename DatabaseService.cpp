@@ -0,0 +1,114 @@
+#include "DatabaseService.h"
+#include <QSqlError>
+#include <QUuid>
+#include <QDebug>
+#include "Database.h"
+#include "StatementCache.h"
+
+DatabaseService::DatabaseService(const QString &path, QObject *parent)
+    : QObject(parent)
+    , m_worker(new QObject())
+    , m_path(path)
+    , m_connectionName("worker-" + QUuid::createUuid().toString(QUuid::WithoutBraces))
+    , m_pending(0)
+{
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_thread.setObjectName("DatabaseService");
+    m_thread.start();
+}
+
+DatabaseService::~DatabaseService()
+{
+    // Queued behind every job already submitted, so those still run; the connection is dropped
+    // on the thread that opened it before the worker's event loop stops.
+    const QString connectionName = m_connectionName;
+    post([connectionName]() {
+        {
+            QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+            if (db.isValid()) {
+                StatementCache::forDatabase(db).logStatistics();
+                StatementCache::release(db);
+                db.close();
+            }
+        }
+        QSqlDatabase::removeDatabase(connectionName);
+        QThread::currentThread()->quit();
+    });
+
+    m_thread.wait();
+}
+
+void DatabaseService::open()
+{
+    const QString path = m_path;
+    const QString connectionName = m_connectionName;
+
+    jobStarted();
+    post([this, path, connectionName]() {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(path);
+
+        bool ok = db.open();
+        QString error;
+        if (!ok) {
+            error = db.lastError().text();
+            qCritical() << "Failed to open database:" << error;
+        } else {
+            // Journal, sync and cache settings must be in place before the first transaction
+            Database::applyStorageProfile(db, Database::configuredStorageProfile());
+            if (!Database::ensureSchema(db)) {
+                ok = false;
+                error = "Failed to create the database tables.";
+            }
+        }
+
+        QMetaObject::invokeMethod(this, [this, ok, error]() {
+            jobFinished();
+            emit opened(ok, error);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void DatabaseService::submit(QObject *context, std::function<void(QSqlDatabase &)> job, std::function<void()> done)
+{
+    submit<bool>(context,
+                 [job](QSqlDatabase &db) {
+                     job(db);
+                     return true;
+                 },
+                 [done](bool) {
+                     if (done) {
+                         done();
+                     }
+                 });
+}
+
+bool DatabaseService::isBusy() const
+{
+    return m_pending > 0;
+}
+
+void DatabaseService::post(std::function<void()> task)
+{
+    QMetaObject::invokeMethod(m_worker, std::move(task), Qt::QueuedConnection);
+}
+
+QSqlDatabase DatabaseService::connection() const
+{
+    return QSqlDatabase::database(m_connectionName, false);
+}
+
+void DatabaseService::jobStarted()
+{
+    if (m_pending++ == 0) {
+        emit busyChanged(true);
+    }
+}
+
+void DatabaseService::jobFinished()
+{
+    if (--m_pending == 0) {
+        emit busyChanged(false);
+    }
+}
@@ -0,0 +1,140 @@
+#ifndef DATABASESERVICE_H
+#define DATABASESERVICE_H
+
+#include <QObject>
+#include <QPointer>
+#include <QSqlDatabase>
+#include <QString>
+#include <QThread>
+#include <functional>
+#include <utility>
+
+/**
+ * @brief The DatabaseService class runs all database work on a dedicated worker thread.
+ *
+ * The service owns its own QSqlDatabase connection, opened on the worker thread, and
+ * executes submitted jobs there one at a time in submission order. Each job receives the
+ * worker's connection; its result is handed back to a completion callback on the thread
+ * that owns the service (the GUI thread), so widgets never block on SQL.
+ *
+ * @code
+ * service->submit<int>(this,
+ *     [](QSqlDatabase &db) { return Transaction::writeTransaction(db, transaction); },
+ *     [this](int id) { ... runs on the GUI thread ... });
+ * @endcode
+ *
+ * The callback is skipped if its context object was destroyed in the meantime.
+ * busyChanged() reports whether jobs are outstanding so the UI can show a busy state.
+ */
+class DatabaseService : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Constructs the service and starts its worker thread. Call open() to connect.
+     * @param path The SQLite database file.
+     * @param parent The parent QObject.
+     */
+    explicit DatabaseService(const QString &path, QObject *parent = nullptr);
+
+    /**
+     * @brief Finishes queued jobs, closes the worker connection and stops the thread.
+     */
+    ~DatabaseService();
+
+    /**
+     * @brief Opens the worker connection, applies the configured storage profile and creates the schema.
+     *
+     * The outcome is reported through opened(). Jobs submitted afterwards run after the open.
+     */
+    void open();
+
+    /**
+     * @brief Runs a job on the worker thread and delivers its result on the service's thread.
+     * @tparam Result The job's return type; it must be copyable or movable.
+     * @param context The object the callback belongs to; the callback is skipped if it is destroyed.
+     * @param job The work to run with the worker's connection.
+     * @param done Receives the job's result on the service's thread.
+     */
+    template<typename Result>
+    void submit(QObject *context, std::function<Result(QSqlDatabase &)> job, std::function<void(Result)> done);
+
+    /**
+     * @brief Runs a job on the worker thread and calls back once it has finished.
+     * @param context The object the callback belongs to; the callback is skipped if it is destroyed.
+     * @param job The work to run with the worker's connection.
+     * @param done Called on the service's thread after the job has run; may be empty.
+     */
+    void submit(QObject *context, std::function<void(QSqlDatabase &)> job, std::function<void()> done = {});
+
+    /**
+     * @brief Checks whether any submitted jobs have not completed yet.
+     * @return true if jobs are outstanding, false otherwise.
+     */
+    bool isBusy() const;
+
+signals:
+    /**
+     * @brief Emitted once open() has completed.
+     * @param ok true if the connection was opened and the schema is in place.
+     * @param error A description of the failure if ok is false.
+     */
+    void opened(bool ok, const QString &error);
+
+    /**
+     * @brief Emitted when the service goes from idle to busy and back.
+     * @param busy true while jobs are outstanding.
+     */
+    void busyChanged(bool busy);
+
+private:
+    QThread m_thread; ///< The worker thread.
+    QObject *m_worker; ///< Object living on the worker thread that jobs are queued to.
+    QString m_path; ///< The SQLite database file.
+    QString m_connectionName; ///< Name of the worker's connection.
+    int m_pending; ///< Jobs submitted but not yet completed; only touched on the service's thread.
+
+    /**
+     * @brief Queues a task to run on the worker thread.
+     * @param task The task.
+     */
+    void post(std::function<void()> task);
+
+    /**
+     * @brief Retrieves the worker's connection; only valid on the worker thread.
+     * @return The connection.
+     */
+    QSqlDatabase connection() const;
+
+    /**
+     * @brief Records a newly submitted job.
+     */
+    void jobStarted();
+
+    /**
+     * @brief Records a completed job.
+     */
+    void jobFinished();
+};
+
+template<typename Result>
+void DatabaseService::submit(QObject *context, std::function<Result(QSqlDatabase &)> job, std::function<void(Result)> done)
+{
+    QPointer<QObject> receiver(context);
+    jobStarted();
+    post([this, receiver, job, done]() {
+        QSqlDatabase db = connection();
+        Result result = job(db);
+
+        // Queued to the service itself, so nothing runs if the service is gone; the receiver
+        // is checked on the service's thread where it lives.
+        QMetaObject::invokeMethod(this, [this, receiver, done, result]() mutable {
+            jobFinished();
+            if (receiver && done) {
+                done(std::move(result));
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+#endif // DATABASESERVICE_H
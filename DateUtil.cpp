@@ -0,0 +1,119 @@
+#include "DateUtil.h"
+#include <QDateTime>
+#include <QTime>
+
+// Civil-from-days conversions use 400-year eras of 146097 days starting on March 1, so leap
+// days fall at the end of each computed year and no month tables are needed.
+
+int DateUtil::fromCivil(int year, int month, int day)
+{
+    year -= month <= 2;
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+    const unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<int>(dayOfEra) - 719468;
+}
+
+void DateUtil::toCivil(int dayNumber, int &year, int &month, int &day)
+{
+    const long long z = static_cast<long long>(dayNumber) + 719468;
+    const long long era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned dayOfEra = static_cast<unsigned>(z - era * 146097);
+    const unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const unsigned monthIndex = (5 * dayOfYear + 2) / 153;
+
+    day = static_cast<int>(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+    month = static_cast<int>(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+    year = static_cast<int>(yearOfEra + era * 400) + (month <= 2);
+}
+
+int DateUtil::parse(const char *text, std::size_t length)
+{
+    if (length != 10 || text[4] != '-' || text[7] != '-') {
+        return InvalidDay;
+    }
+
+    static const int digitPositions[] = {0, 1, 2, 3, 5, 6, 8, 9};
+    int digits[8];
+    for (int i = 0; i < 8; ++i) {
+        const unsigned digit = static_cast<unsigned char>(text[digitPositions[i]]) - '0';
+        if (digit > 9) {
+            return InvalidDay;
+        }
+        digits[i] = static_cast<int>(digit);
+    }
+
+    const int year = digits[0] * 1000 + digits[1] * 100 + digits[2] * 10 + digits[3];
+    const int month = digits[4] * 10 + digits[5];
+    const int day = digits[6] * 10 + digits[7];
+    if (month < 1 || month > 12 || day < 1) {
+        return InvalidDay;
+    }
+
+    static const int daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    const bool leapYear = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    const int monthLength = daysInMonth[month - 1] + (month == 2 && leapYear ? 1 : 0);
+    if (day > monthLength) {
+        return InvalidDay;
+    }
+
+    return fromCivil(year, month, day);
+}
+
+int DateUtil::parse(const std::string &text)
+{
+    return parse(text.data(), text.size());
+}
+
+int DateUtil::parse(const QString &text)
+{
+    if (text.size() != 10) {
+        return InvalidDay;
+    }
+    const QByteArray latin1 = text.toLatin1();
+    return parse(latin1.constData(), static_cast<std::size_t>(latin1.size()));
+}
+
+std::string DateUtil::format(int dayNumber)
+{
+    int year = 0;
+    int month = 0;
+    int day = 0;
+    toCivil(dayNumber, year, month, day);
+
+    char buffer[11];
+    buffer[0] = static_cast<char>('0' + (year / 1000) % 10);
+    buffer[1] = static_cast<char>('0' + (year / 100) % 10);
+    buffer[2] = static_cast<char>('0' + (year / 10) % 10);
+    buffer[3] = static_cast<char>('0' + year % 10);
+    buffer[4] = '-';
+    buffer[5] = static_cast<char>('0' + month / 10);
+    buffer[6] = static_cast<char>('0' + month % 10);
+    buffer[7] = '-';
+    buffer[8] = static_cast<char>('0' + day / 10);
+    buffer[9] = static_cast<char>('0' + day % 10);
+    buffer[10] = '\0';
+    return std::string(buffer, 10);
+}
+
+QString DateUtil::toString(int dayNumber)
+{
+    return QString::fromStdString(format(dayNumber));
+}
+
+int DateUtil::fromQDate(const QDate &date)
+{
+    return static_cast<int>(date.toJulianDay() - JulianDayOfEpoch);
+}
+
+QDate DateUtil::toQDate(int dayNumber)
+{
+    return QDate::fromJulianDay(static_cast<qint64>(dayNumber) + JulianDayOfEpoch);
+}
+
+qint64 DateUtil::toMSecsSinceEpoch(int dayNumber)
+{
+    return QDateTime(toQDate(dayNumber), QTime(0, 0)).toMSecsSinceEpoch();
+}
@@ -0,0 +1,103 @@
+#ifndef DATEUTIL_H
+#define DATEUTIL_H
+
+#include <QDate>
+#include <QString>
+#include <cstddef>
+#include <limits>
+#include <string>
+
+/**
+ * @brief The DateUtil class converts between calendar dates and integer day numbers.
+ *
+ * A day number counts days since 1970-01-01 (day 0) in the proleptic Gregorian calendar.
+ * Transactions keep their date as a day number in memory and in the database, so ordering,
+ * range checks and per-day bucketing are plain integer operations; "yyyy-MM-dd" text is
+ * only parsed or produced where dates enter or leave the application.
+ */
+class DateUtil {
+public:
+    static constexpr int InvalidDay = std::numeric_limits<int>::min(); ///< Returned for unparseable dates.
+    static constexpr int MinDay = InvalidDay + 1;                      ///< Lower bound for open-ended ranges.
+    static constexpr int MaxDay = std::numeric_limits<int>::max();     ///< Upper bound for open-ended ranges.
+
+    /**
+     * @brief Converts a calendar date to a day number.
+     * @param year The year.
+     * @param month The month, 1-12.
+     * @param day The day of the month, 1-31.
+     * @return The day number; the date is not validated.
+     */
+    static int fromCivil(int year, int month, int day);
+
+    /**
+     * @brief Converts a day number to a calendar date.
+     * @param dayNumber The day number.
+     * @param year Receives the year.
+     * @param month Receives the month, 1-12.
+     * @param day Receives the day of the month, 1-31.
+     */
+    static void toCivil(int dayNumber, int &year, int &month, int &day);
+
+    /**
+     * @brief Parses a date in strict "yyyy-MM-dd" format.
+     * @param text The characters to parse.
+     * @param length The number of characters; must be 10.
+     * @return The day number, or InvalidDay if the text is not a valid date.
+     */
+    static int parse(const char *text, std::size_t length);
+
+    /**
+     * @brief Parses a date in strict "yyyy-MM-dd" format.
+     * @param text The date text.
+     * @return The day number, or InvalidDay if the text is not a valid date.
+     */
+    static int parse(const std::string &text);
+
+    /**
+     * @brief Parses a date in strict "yyyy-MM-dd" format.
+     * @param text The date text.
+     * @return The day number, or InvalidDay if the text is not a valid date.
+     */
+    static int parse(const QString &text);
+
+    /**
+     * @brief Formats a day number as "yyyy-MM-dd".
+     * @param dayNumber The day number.
+     * @return The formatted date.
+     */
+    static std::string format(int dayNumber);
+
+    /**
+     * @brief Formats a day number as "yyyy-MM-dd".
+     * @param dayNumber The day number.
+     * @return The formatted date.
+     */
+    static QString toString(int dayNumber);
+
+    /**
+     * @brief Converts a QDate to a day number.
+     * @param date A valid date.
+     * @return The day number.
+     */
+    static int fromQDate(const QDate &date);
+
+    /**
+     * @brief Converts a day number to a QDate.
+     * @param dayNumber The day number.
+     * @return The date.
+     */
+    static QDate toQDate(int dayNumber);
+
+    /**
+     * @brief Retrieves local midnight of a day as milliseconds since the epoch, for chart axes.
+     * @param dayNumber The day number.
+     * @return The timestamp of the start of that day in local time.
+     */
+    static qint64 toMSecsSinceEpoch(int dayNumber);
+
+private:
+    static constexpr int JulianDayOfEpoch = 2440588; ///< QDate Julian day number of 1970-01-01.
+};
+
+#endif // DATEUTIL_H
@@ -11,7 +11,17 @@
 #include <QPen>
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <map>
+#include <tuple>
+#include "DateUtil.h"
+#include "Categories.h"
+
+namespace {
+
+const size_t MaxPatchedRows = 64; // Larger changes rebuild the chart instead of moving points one by one
+
+} // namespace
 
 GraphView::GraphView(QWidget *parent)
     : QWidget(parent)
@@ -23,24 +33,16 @@ GraphView::GraphView(QWidget *parent)
     , expenseScatterSeries(new QScatterSeries())
     , axisX(new QDateTimeAxis())
     , axisY(new QValueAxis())
+    , ledgerSubscription(0)
     , tooltipVisible(false)
     , chartTooltip(new QGraphicsSimpleTextItem(chart))
+    , rollupLoaded(false)
+    , maxY(0.0)
 {
     ui->setupUi(this);
 
-    const QStringList predefinedCategories = {
-        "Pay",
-        "Groceries",
-        "Rent",
-        "Utilities",
-        "Transportation",
-        "Entertainment",
-        "Healthcare",
-        "Education",
-        "Savings"
-    };
     ui->categoryComboBox->addItem("All");
-    ui->categoryComboBox->addItems(predefinedCategories);
+    ui->categoryComboBox->addItems(Categories::predefined());
 
     // Initialize the line series
     incomeLineSeries->setName("Income");
@@ -132,6 +134,9 @@ GraphView::GraphView(QWidget *parent)
 
 GraphView::~GraphView()
 {
+    if (ledger) {
+        ledger->unsubscribe(ledgerSubscription);
+    }
     delete ui;
 }
 
@@ -189,12 +194,119 @@ void GraphView::toggleOptions()
     ui->label->setText(currentlyVisible ? "Show Options" : "Hide Options");
 }
 
-void GraphView::setAllTransactions(const std::vector<Transaction> &transactions)
+void GraphView::addTransaction(const Ledger::RowView &transaction)
+{
+    if (rollupLoaded) {
+        addToRollup(transaction);
+    }
+
+    if (!matchesFilters(transaction))
+        return;
+
+    Money &total = dailyTotals[transaction.getDay()];
+    bool wasPlotted = total.isPositive();
+    total += transaction.calculateNetAmount();
+    QPointF point(DateUtil::toMSecsSinceEpoch(transaction.getDay()), total.toDouble());
+
+    bool showIncome = ui->incomeRadioButton->isChecked();
+    QLineSeries *activeLineSeries = showIncome ? incomeLineSeries : expenseLineSeries;
+    QScatterSeries *activeScatterSeries = showIncome ? incomeScatterSeries : expenseScatterSeries;
+
+    // Points are ordered by date, so binary search for the position of this day
+    int low = 0;
+    int high = activeLineSeries->count();
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (activeLineSeries->at(mid).x() < point.x()) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    if (wasPlotted && total.isPositive()) {
+        activeLineSeries->replace(low, point);
+        activeScatterSeries->replace(low, point);
+    } else if (wasPlotted) {
+        activeLineSeries->remove(low);
+        activeScatterSeries->remove(low);
+    } else if (total.isPositive()) {
+        activeLineSeries->insert(low, point);
+        activeScatterSeries->insert(low, point);
+    }
+
+    maxY = std::max(maxY, total.toDouble());
+    updateAxisRanges();
+}
+
+void GraphView::setLedger(std::shared_ptr<const Ledger> ledger)
 {
-    allTransactions = transactions;
+    if (this->ledger) {
+        this->ledger->unsubscribe(ledgerSubscription);
+        ledgerSubscription = 0;
+    }
+    this->ledger = std::move(ledger);
+    if (this->ledger) {
+        ledgerSubscription = this->ledger->subscribe([this](const Ledger::Change &change) {
+            applyLedgerChange(change);
+        });
+    }
     applyFiltering();
 }
 
+void GraphView::applyLedgerChange(const Ledger::Change &change)
+{
+    if (change.reset || !change.removedIds.empty()) {
+        // Removed rows are gone from the ledger, so their rollup rows cannot be corrected;
+        // the chart is aggregated from the ledger until the next setDailyTotals()
+        rollupRows.clear();
+        rollupLoaded = false;
+        applyFiltering();
+        return;
+    }
+    if (change.inserted.size() > MaxPatchedRows) {
+        if (rollupLoaded) {
+            for (quint32 position : change.inserted) {
+                addToRollup(Ledger::RowView(ledger.get(), position));
+            }
+        }
+        applyFiltering();
+        return;
+    }
+    for (quint32 position : change.inserted) {
+        addTransaction(Ledger::RowView(ledger.get(), position));
+    }
+}
+
+void GraphView::refresh()
+{
+    applyFiltering();
+}
+
+void GraphView::setDailyTotals(const std::vector<DailyTotals::Row> &rows, bool loaded)
+{
+    rollupRows = rows;
+    rollupLoaded = loaded;
+    applyFiltering();
+}
+
+void GraphView::addToRollup(const Ledger::RowView &transaction)
+{
+    const QString category = QString::fromStdString(transaction.getCategory());
+    const QString type = QString::fromStdString(transaction.getType());
+    const DailyTotals::Row key{transaction.getDay(), category, type, Money(), 0};
+
+    auto pos = std::lower_bound(rollupRows.begin(), rollupRows.end(), key,
+                                [](const DailyTotals::Row &a, const DailyTotals::Row &b) {
+                                    return std::tie(a.day, a.category, a.type) < std::tie(b.day, b.category, b.type);
+                                });
+    if (pos == rollupRows.end() || pos->day != key.day || pos->category != category || pos->type != type) {
+        pos = rollupRows.insert(pos, key);
+    }
+    pos->net += transaction.calculateNetAmount();
+    ++pos->count;
+}
+
 void GraphView::setCurrentUser(const User &user)
 {
     currentUser = user;
@@ -210,69 +322,77 @@ void GraphView::updateGraphFilters()
     applyFiltering();
 }
 
+bool GraphView::matchesFilters(const Ledger::RowView &transaction) const
+{
+    return currentQuery().matches(transaction);
+}
+
+bool GraphView::matchesFilters(const DailyTotals::Row &row) const
+{
+    if (!currentCategoryFilter.isEmpty() && row.category != currentCategoryFilter)
+        return false;
+
+    bool showIncome = ui->incomeRadioButton->isChecked();
+    bool showExpenses = ui->expensesRadioButton->isChecked();
+    bool isIncome = row.type == "Income";
+    return (showIncome && isIncome) || (showExpenses && !isIncome);
+}
+
+LedgerQuery GraphView::currentQuery() const
+{
+    LedgerQuery query;
+    query.setCategory(currentCategoryFilter);
+    query.setSubcategoryText(currentSubCategoryFilter);
+    query.setTypes(ui->incomeRadioButton->isChecked(), ui->expensesRadioButton->isChecked());
+    return query;
+}
+
 void GraphView::applyFiltering()
 {
     // Determine transaction type from radio buttons
     bool showIncome = ui->incomeRadioButton->isChecked();
-    bool showExpenses = ui->expensesRadioButton->isChecked();
 
     // Initialize daily totals
-    std::map<QString, double> dailyTotals;
+    dailyTotals.clear();
 
     // Prepare for data points
     QVector<QPointF> dataPoints;
-    dataPoints.reserve(allTransactions.size());
-
-    // Track min and max Y
-    double minY = std::numeric_limits<double>::max();
-    double maxY = std::numeric_limits<double>::lowest();
-
-    // Filter and aggregate
-    for (const auto &t : allTransactions) {
-        // Category filter
-        if (!currentCategoryFilter.isEmpty()) {
-            QString category = QString::fromStdString(t.getCategory());
-            if (category != currentCategoryFilter)
-                continue;
-        }
 
-        // Subcategory filter
-        if (!currentSubCategoryFilter.isEmpty()) {
-            QString subcategory = QString::fromStdString(t.getSubcategory());
-            if (!subcategory.contains(currentSubCategoryFilter, Qt::CaseInsensitive))
-                continue;
-        }
+    // Track max Y
+    maxY = std::numeric_limits<double>::lowest();
 
-        // Transaction type filter
-        bool isIncome = t.isIncomeTransaction();
-        if (!((showIncome && isIncome) || (showExpenses && !isIncome))) {
-            continue;
+    // Filter and aggregate by day; the rollup already has one row per day, category and type,
+    // so only a subcategory search needs the individual transactions
+    if (rollupLoaded && currentSubCategoryFilter.isEmpty()) {
+        for (const auto &row : rollupRows) {
+            if (matchesFilters(row))
+                dailyTotals[row.day] += row.net;
+        }
+    } else if (ledger) {
+        // Rows come back in date order, so each day's total is accumulated before moving to the next
+        const std::vector<quint32> positions = currentQuery().positions(*ledger);
+        for (size_t i = 0; i < positions.size();) {
+            const int day = Ledger::RowView(ledger.get(), positions[i]).getDay();
+            size_t end = i + 1;
+            while (end < positions.size() && Ledger::RowView(ledger.get(), positions[end]).getDay() == day) {
+                ++end;
+            }
+            // Each day's run of positions is summed by a gather kernel
+            dailyTotals.emplace_hint(dailyTotals.end(), day, ledger->netTotal(positions.data() + i, end - i));
+            i = end;
         }
-
-        // Aggregate by day
-        QString dateKey = QString::fromStdString(t.getDate());
-        dailyTotals[dateKey] += t.calculateNetAmount();
     }
 
-    // Convert dailyTotals to dataPoints
+    // Convert dailyTotals to dataPoints; the map is keyed by day number, so points come out in date order
+    dataPoints.reserve(static_cast<int>(dailyTotals.size()));
     for (const auto &entry : dailyTotals) {
-        QDateTime dt = QDateTime::fromString(entry.first, "yyyy-MM-dd");
-        if (!dt.isValid()) continue;
-
-        qint64 ms = dt.toMSecsSinceEpoch();
-        double val = entry.second;
-        if (val > 0) {
-            dataPoints.append(QPointF(ms, val));
-            if (val < minY) minY = val;
+        double val = entry.second.toDouble();
+        if (entry.second.isPositive()) {
+            dataPoints.append(QPointF(DateUtil::toMSecsSinceEpoch(entry.first), val));
             if (val > maxY) maxY = val;
         }
     }
 
-    // Sort by date
-    std::sort(dataPoints.begin(), dataPoints.end(), [](const QPointF &a, const QPointF &b){
-        return a.x() < b.x();
-    });
-
     // Update chart title
     QString typeStr = showIncome ? "Income" : "Expenses";
     QString categoryStr = currentCategoryFilter.isEmpty() ? "All" : currentCategoryFilter;
@@ -282,26 +402,6 @@ void GraphView::applyFiltering()
     }
     chart->setTitle(title);
 
-    // Configure axes
-    int uniqueDateCount = static_cast<int>(dailyTotals.size());
-    uniqueDateCount = std::max(uniqueDateCount, 2);
-    axisX->setTickCount(uniqueDateCount);
-    axisX->setFormat("yyyy-MM-dd");
-    axisX->setLabelsAngle(-45);
-
-    if (!dataPoints.isEmpty()) {
-        QDateTime minDate = QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(dataPoints.first().x()));
-        QDateTime maxDate = QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(dataPoints.last().x()));
-
-        QDateTime bufferMinDate = minDate.addDays(-2);
-        QDateTime bufferMaxDate = maxDate.addDays(2);
-        if (bufferMinDate.isValid() && bufferMaxDate.isValid()) {
-            axisX->setRange(bufferMinDate, bufferMaxDate);
-        } else {
-            axisX->setRange(minDate, maxDate);
-        }
-    }
-
     setData(dataPoints, maxY);
 }
 
@@ -327,7 +427,22 @@ void GraphView::setData(const QVector<QPointF> &dataPoints, double maxY)
         activeScatterSeries->replace(dataPoints);
     }
 
-    if (dataPoints.isEmpty()) {
+    this->maxY = maxY;
+    updateAxisRanges();
+}
+
+void GraphView::updateAxisRanges()
+{
+    QLineSeries *activeLineSeries = ui->incomeRadioButton->isChecked() ? incomeLineSeries : expenseLineSeries;
+
+    // Configure axes
+    int uniqueDateCount = static_cast<int>(dailyTotals.size());
+    uniqueDateCount = std::max(uniqueDateCount, 2);
+    axisX->setTickCount(uniqueDateCount);
+    axisX->setFormat("yyyy-MM-dd");
+    axisX->setLabelsAngle(-45);
+
+    if (activeLineSeries->count() == 0) {
         QDateTime now = QDateTime::currentDateTime();
         axisX->setRange(now, now.addDays(1));
         axisY->setRange(0, 1);
@@ -335,6 +450,17 @@ void GraphView::setData(const QVector<QPointF> &dataPoints, double maxY)
         return;
     }
 
+    QDateTime minDate = QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(activeLineSeries->at(0).x()));
+    QDateTime maxDate = QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(activeLineSeries->at(activeLineSeries->count() - 1).x()));
+
+    QDateTime bufferMinDate = minDate.addDays(-2);
+    QDateTime bufferMaxDate = maxDate.addDays(2);
+    if (bufferMinDate.isValid() && bufferMaxDate.isValid()) {
+        axisX->setRange(bufferMinDate, bufferMaxDate);
+    } else {
+        axisX->setRange(minDate, maxDate);
+    }
+
     double range = maxY;
     if (range < 0) range = 0;
     double padding = range * 0.1;
@@ -355,11 +481,22 @@ void GraphView::setData(const QVector<QPointF> &dataPoints, double maxY)
 
 void GraphView::resetUI()
 {
-    // Reset filters
+    bool filtersChanged = !currentCategoryFilter.isEmpty() || !currentSubCategoryFilter.isEmpty()
+                          || ui->incomeRadioButton->isChecked();
+
+    // Reset filters without triggering a refilter for each widget
+    ui->categoryComboBox->blockSignals(true);
+    ui->subCategoryLneEdit->blockSignals(true);
+    ui->incomeRadioButton->blockSignals(true);
+    ui->expensesRadioButton->blockSignals(true);
     ui->categoryComboBox->setCurrentIndex(0);
     ui->subCategoryLneEdit->clear();
     ui->incomeRadioButton->setChecked(false);
     ui->expensesRadioButton->setChecked(true);
+    ui->categoryComboBox->blockSignals(false);
+    ui->subCategoryLneEdit->blockSignals(false);
+    ui->incomeRadioButton->blockSignals(false);
+    ui->expensesRadioButton->blockSignals(false);
 
     // Reset options group box
     ui->optionsGroupBox->setVisible(false);
@@ -368,6 +505,8 @@ void GraphView::resetUI()
     currentCategoryFilter = "";
     currentSubCategoryFilter = "";
 
-    // Re-apply filtering with default filters
-    applyFiltering();
+    // The default chart is kept up to date incrementally, so only rebuild it if filters changed
+    if (filtersChanged) {
+        applyFiltering();
+    }
 }
@@ -12,8 +12,13 @@
 #include <QtCharts/QScatterSeries>
 #include <QTimer>
 #include <QGraphicsSimpleTextItem>
+#include <map>
+#include <memory>
 #include "User.h"
 #include "Transaction.h"
+#include "Ledger.h"
+#include "LedgerQuery.h"
+#include "DailyTotals.h"
 
 namespace Ui {
 class GraphView;
@@ -38,10 +43,41 @@ public:
     ~GraphView();
 
     /**
-     * @brief Sets all transactions for filtering and displaying in the graph.
-     * @param transactions All user transactions.
+     * @brief Shows a single newly saved transaction, already added to the ledger, by patching the chart in place.
+     *
+     * Only the daily total for the transaction's date is updated; the matching point is
+     * replaced or inserted in the active series instead of rebuilding it.
+     *
+     * @param transaction The ledger row of the transaction that was saved.
+     */
+    void addTransaction(const Ledger::RowView &transaction);
+
+    /**
+     * @brief Sets the user's daily_totals rows used to aggregate the chart.
+     *
+     * While rows are set, filters without a subcategory are answered from these aggregates
+     * instead of walking every transaction. Pass an empty vector with loaded set to false
+     * to fall back to the ledger.
+     *
+     * @param rows The user's rows ordered by day, category and type.
+     * @param loaded Whether the rows reflect the user's transactions.
      */
-    void setAllTransactions(const std::vector<Transaction> &transactions);
+    void setDailyTotals(const std::vector<DailyTotals::Row> &rows, bool loaded = true);
+
+    /**
+     * @brief Sets the ledger whose transactions are charted, and rebuilds the chart.
+     *
+     * The ledger is shared, not copied; subcategory searches use its trigram index. The
+     * view subscribes to the ledger's changes and keeps itself current.
+     *
+     * @param ledger The current user's ledger; may be null to chart nothing.
+     */
+    void setLedger(std::shared_ptr<const Ledger> ledger);
+
+    /**
+     * @brief Rebuilds the chart after the ledger was cleared or reloaded.
+     */
+    void refresh();
 
     /**
      * @brief Sets the current user.
@@ -89,15 +125,64 @@ private:
     QDateTimeAxis *axisX; ///< X-axis representing dates.
     QValueAxis *axisY; ///< Y-axis representing total values.
     User currentUser; ///< The current user for whom the graph is displayed.
-    std::vector<Transaction> allTransactions; ///< All transactions associated with the current user.
+    std::shared_ptr<const Ledger> ledger; ///< The current user's transactions, shared with the other views; may be null.
+    int ledgerSubscription; ///< Token of the subscription to ledger's changes, or 0.
     QString currentCategoryFilter; ///< Current category filter applied to the graph.
     QString currentSubCategoryFilter; ///< Current subcategory filter applied to the graph.
     QTimer tooltipHideTimer;       ///< Timer to delay hiding the tooltip after hover ends.
     bool tooltipVisible;           ///< Flag indicating if the tooltip is currently visible.
     QGraphicsSimpleTextItem *chartTooltip; ///< The custom tooltip graphics item.
+    std::map<int, Money> dailyTotals; ///< Net totals per day number for the currently filtered transactions.
+    std::vector<DailyTotals::Row> rollupRows; ///< The user's daily_totals rows, kept current by addTransaction().
+    bool rollupLoaded; ///< Whether rollupRows can be used in place of the ledger.
+    double maxY; ///< Largest plotted daily total.
+
+    /**
+     * @brief Checks whether a transaction passes the current category, subcategory and type filters.
+     * @param transaction The transaction to check.
+     * @return true if the transaction contributes to the chart, false otherwise.
+     */
+    bool matchesFilters(const Ledger::RowView &transaction) const;
+
+    /**
+     * @brief Checks whether an aggregate row passes the current category and type filters.
+     *
+     * Aggregates carry no subcategory, so this must only be used while no subcategory filter is set.
+     *
+     * @param row The aggregate row to check.
+     * @return true if the row contributes to the chart, false otherwise.
+     */
+    bool matchesFilters(const DailyTotals::Row &row) const;
+
+    /**
+     * @brief Updates the chart for a change of the ledger.
+     *
+     * A few added rows are patched in with addTransaction(); a reset, a removal or a large
+     * batch, such as a page of a load, rebuilds the chart.
+     *
+     * @param change The change.
+     */
+    void applyLedgerChange(const Ledger::Change &change);
+
+    /**
+     * @brief Builds a ledger query from the current category, subcategory and type filters.
+     * @return The query.
+     */
+    LedgerQuery currentQuery() const;
+
+    /**
+     * @brief Adds a transaction to the matching row of rollupRows, inserting the row if needed.
+     * @param transaction The transaction to add.
+     */
+    void addToRollup(const Ledger::RowView &transaction);
+
+    /**
+     * @brief Adjusts the axis ranges and tick count to the points of the active series.
+     */
+    void updateAxisRanges();
 
     /**
-     * @brief Apply category/subcategory filtering to allTransactions and update the chart.
+     * @brief Apply category/subcategory filtering to the ledger and update the chart.
      * Only show one line (Income or Expenses) based on the selected radio button.
      */
     void applyFiltering();
@@ -1,53 +1,551 @@
 #include "Ledger.h"
+#include "AmountKernels.h"
+#include <QDebug>
 #include <algorithm>
 #include <iostream>
 
+Transaction Ledger::RowView::toTransaction() const {
+    // Copy the ids; going through the strings would intern them again
+    Transaction transaction;
+    transaction.setId(getId());
+    transaction.setUserId(getUserId());
+    transaction.setDay(getDay());
+    transaction.setCategoryId(getCategoryId());
+    transaction.setSubcategoryId(getSubcategoryId());
+    transaction.setAmount(getAmount());
+    transaction.setTypeId(getTypeId());
+    transaction.setTaxWithheld(isTaxWithheld());
+    transaction.setTaxAmount(getTaxAmount());
+    return transaction;
+}
+
 Ledger::Ledger()
-    : balance(0.0)
+    : removedCount(0)
+    , balance()
+    , currentVersion(0)
+    , batchDepth(0)
+    , pendingFirstPosition(0)
+    , nextSubscriberToken(1)
+    , indexedCount(0)
 {
 }
 
-void Ledger::addTransaction(const Transaction &transaction) {
-    transactions.push_back(transaction);
-    if (transaction.isIncomeTransaction()) {
+quint64 Ledger::version() const {
+    return currentVersion;
+}
+
+int Ledger::subscribe(Subscriber subscriber) const {
+    const int token = nextSubscriberToken++;
+    subscribers.emplace_back(token, std::move(subscriber));
+    return token;
+}
+
+void Ledger::unsubscribe(int token) const {
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+                                     [token](const std::pair<int, Subscriber> &entry) { return entry.first == token; }),
+                      subscribers.end());
+}
+
+void Ledger::beginBatch() {
+    ++batchDepth;
+}
+
+void Ledger::endBatch() {
+    if (batchDepth > 0 && --batchDepth == 0) {
+        deliver();
+    }
+}
+
+Ledger::RowView Ledger::addTransaction(const Transaction &transaction) {
+    // Claim the id first; a second row with the same id would orphan the first one's position
+    auto claimed = positionsById.emplace(transaction.getId(), static_cast<quint32>(ids.size()));
+    if (!claimed.second) {
+        qWarning() << "Transaction" << transaction.getId() << "is already in the ledger; the duplicate was ignored.";
+        return RowView(this, claimed.first->second);
+    }
+
+    const quint32 position = appendColumns(transaction);
+    const Money net = transaction.calculateNetAmount();
+    netAmounts[position] = net;
+    signedNetAmounts[position] = incomeFlags[position] ? net : -net;
+
+    if (incomeFlags[position]) {
         balance += transaction.getAmount();
     } else {
         balance -= transaction.getAmount();
     }
+    indexPosition(position);
+    publish();
+    return RowView(this, position);
+}
+
+void Ledger::addTransactions(const std::vector<Transaction> &transactions) {
+    const size_t first = ids.size();
+    reserveColumns(first + transactions.size());
+    size_t duplicates = 0;
+    for (const Transaction &transaction : transactions) {
+        if (positionsById.emplace(transaction.getId(), static_cast<quint32>(ids.size())).second) {
+            appendColumns(transaction);
+        } else {
+            ++duplicates;
+        }
+    }
+    if (duplicates > 0) {
+        qWarning() << duplicates << "transactions are already in the ledger; the duplicates were ignored.";
+    }
+    const size_t count = ids.size() - first;
+
+    // Net amounts and the balance change come from one pass over the new columns each
+    const size_t clamped = AmountKernels::netAmounts(amounts.data() + first, incomeFlags.data() + first,
+                                                     taxWithheldFlags.data() + first, taxAmounts.data() + first,
+                                                     count, netAmounts.data() + first,
+                                                     signedNetAmounts.data() + first);
+    if (clamped > 0) {
+        qWarning() << clamped << "transactions have a tax percentage outside 0-100%; it was clamped.";
+    }
+    balance += AmountKernels::signedSum(amounts.data() + first, incomeFlags.data() + first, count);
+
+    for (size_t position = first; position < first + count; ++position) {
+        indexPosition(static_cast<quint32>(position));
+    }
+    if (count > 0) {
+        publish();
+    }
 }
 
 bool Ledger::removeTransaction(int transactionId) {
-    auto it = std::find_if(transactions.begin(), transactions.end(),
-                           [transactionId](const Transaction &t) { return t.getId() == transactionId; });
+    auto it = positionsById.find(transactionId);
+    if (it == positionsById.end()) {
+        return false;
+    }
+    const quint32 position = it->second;
+    positionsById.erase(it);
+    markRemoved(position);
 
-    if (it != transactions.end()) {
-        // Update balance before removing
-        if (it->isIncomeTransaction()) {
-            balance -= it->getAmount();
-        } else {
-            balance += it->getAmount();
+    // The date order is sorted by day, so only the entries of this day are searched
+    const int day = days[position];
+    auto first = std::lower_bound(dateOrder.begin(), dateOrder.end(), day,
+                                  [this](quint32 other, int d) { return days[other] < d; });
+    dateOrder.erase(std::find(first, dateOrder.end(), position));
+
+    compactIfNeeded();
+    publish();
+    return true;
+}
+
+size_t Ledger::removeTransactions(const std::vector<int> &transactionIds) {
+    size_t removed = 0;
+    for (int transactionId : transactionIds) {
+        auto it = positionsById.find(transactionId);
+        if (it != positionsById.end()) {
+            markRemoved(it->second);
+            positionsById.erase(it);
+            ++removed;
         }
-        transactions.erase(it);
-        return true;
     }
-    return false;
+
+    if (removed > 0) {
+        dateOrder.erase(std::remove_if(dateOrder.begin(), dateOrder.end(),
+                                       [this](quint32 position) { return removedFlags[position] != 0; }),
+                        dateOrder.end());
+        compactIfNeeded();
+        publish();
+    }
+    return removed;
 }
 
-double Ledger::getBalance() const {
+Money Ledger::getBalance() const {
     return balance;
 }
 
+Money Ledger::balanceAsOf(int day) const {
+    return netByDay.sumThrough(day);
+}
+
+Money Ledger::sumBetween(int fromDay, int toDay) const {
+    return netByDay.sumBetween(fromDay, toDay);
+}
+
+Money Ledger::netTotal(const quint32 *positions, size_t count) const {
+    return AmountKernels::gatherSum(netAmounts.data(), positions, count);
+}
+
 std::vector<Transaction> Ledger::getAllTransactions() const {
-    return transactions;
+    std::vector<Transaction> result;
+    result.reserve(dateOrder.size());
+    for (RowView row : *this) {
+        result.push_back(row.toTransaction());
+    }
+    return result;
+}
+
+size_t Ledger::size() const {
+    return dateOrder.size();
+}
+
+int Ledger::maxId() const {
+    int highest = 0;
+    for (size_t position = 0; position < ids.size(); ++position) {
+        if (!removedFlags[position]) {
+            highest = std::max(highest, ids[position]);
+        }
+    }
+    return highest;
+}
+
+size_t Ledger::memoryUsage() const {
+    auto columnBytes = [](const auto &column) {
+        return column.capacity() * sizeof(column[0]);
+    };
+    // Hash maps hold one node per entry plus their bucket array
+    auto mapBytes = [](const auto &map) {
+        return map.bucket_count() * sizeof(void *) + map.size() * (sizeof(void *) + sizeof(*map.begin()));
+    };
+
+    size_t bytes = columnBytes(ids) + columnBytes(userIds) + columnBytes(days) + columnBytes(amounts)
+                   + columnBytes(netAmounts) + columnBytes(signedNetAmounts) + columnBytes(incomeFlags)
+                   + columnBytes(taxWithheldFlags) + columnBytes(taxAmounts) + columnBytes(categoryIds)
+                   + columnBytes(subcategoryIds) + columnBytes(typeIds) + columnBytes(removedFlags)
+                   + columnBytes(dateOrder) + mapBytes(positionsById) + netByDay.memoryUsage()
+                   + mapBytes(categoryRows) + mapBytes(subcategoryRows) + incomeRows.memoryUsage()
+                   + expenseRows.memoryUsage() + withheldRows.memoryUsage() + notWithheldRows.memoryUsage()
+                   + subcategoryIndex.memoryUsage();
+    for (const auto &entry : categoryRows) {
+        bytes += entry.second.memoryUsage();
+    }
+    for (const auto &entry : subcategoryRows) {
+        bytes += entry.second.memoryUsage();
+    }
+    return bytes;
+}
+
+Ledger::RowView Ledger::operator[](size_t index) const {
+    return RowView(this, dateOrder[index]);
+}
+
+Ledger::const_iterator Ledger::begin() const {
+    return const_iterator(this, dateOrder.begin());
+}
+
+Ledger::const_iterator Ledger::end() const {
+    return const_iterator(this, dateOrder.end());
+}
+
+std::vector<Ledger::RowView> Ledger::findBySubcategory(const QString &text) const {
+    std::vector<quint32> matches = subcategoryMatches(text);
+
+    // Same order as dateOrder: by date, then by the order added, which is the position
+    std::stable_sort(matches.begin(), matches.end(), [this](quint32 a, quint32 b) {
+        return days[a] < days[b];
+    });
+
+    std::vector<RowView> result;
+    result.reserve(matches.size());
+    for (quint32 position : matches) {
+        result.emplace_back(this, position);
+    }
+    return result;
+}
+
+std::vector<Money> Ledger::runningBalances() const {
+    std::vector<Money> result(dateOrder.size());
+    Money running;
+    for (size_t i = 0; i < dateOrder.size(); ++i) {
+        const quint32 position = dateOrder[i];
+        running += incomeFlags[position] ? amounts[position] : -amounts[position];
+        result[i] = running;
+    }
+    return result;
 }
 
 void Ledger::printAllTransactions() const {
-    for (const auto &t : transactions) {
-        std::cout << t.toString() << std::endl;
+    for (RowView row : *this) {
+        std::cout << row.toTransaction().toString() << std::endl;
     }
 }
 
 void Ledger::clear() {
-    transactions.clear();
-    balance = 0.0;
+    ids.clear();
+    userIds.clear();
+    days.clear();
+    amounts.clear();
+    netAmounts.clear();
+    signedNetAmounts.clear();
+    incomeFlags.clear();
+    taxWithheldFlags.clear();
+    taxAmounts.clear();
+    categoryIds.clear();
+    subcategoryIds.clear();
+    typeIds.clear();
+    removedFlags.clear();
+    dateOrder.clear();
+    positionsById.clear();
+    removedCount = 0;
+    subcategoryIndex.clear();
+    indexedCount = 0;
+    balance = Money();
+    netByDay.clear();
+    rebuildBitmaps();
+
+    // Subscribers rebuild on a reset, so nothing recorded before it matters
+    pending.reset = true;
+    pending.inserted.clear();
+    pending.removedIds.clear();
+    pendingFirstPosition = 0;
+    publish();
+}
+
+void Ledger::updateSubcategoryIndex() const {
+    for (; indexedCount < ids.size(); ++indexedCount) {
+        subcategoryIndex.add(static_cast<quint32>(indexedCount),
+                             QString::fromStdString(StringInterner::lookup(subcategoryIds[indexedCount])));
+    }
+}
+
+std::vector<quint32> Ledger::subcategoryMatches(const QString &text) const {
+    updateSubcategoryIndex();
+
+    std::vector<quint32> candidates;
+    if (!subcategoryIndex.candidates(text, candidates)) {
+        candidates.resize(ids.size());
+        for (quint32 i = 0; i < candidates.size(); ++i) {
+            candidates[i] = i;
+        }
+    }
+
+    // Candidates have every trigram of the text, but not necessarily in sequence. Rows share
+    // interned strings, so each distinct subcategory is compared once. The verdicts are keyed
+    // by the candidates' own ids, since the interner is shared by every user and only grows.
+    std::unordered_map<quint32, bool> verdicts;
+    std::vector<quint32> matches;
+    matches.reserve(candidates.size());
+    for (quint32 position : candidates) {
+        if (removedFlags[position]) {
+            continue;
+        }
+        const quint32 subcategoryId = subcategoryIds[position];
+        auto verdict = verdicts.find(subcategoryId);
+        if (verdict == verdicts.end()) {
+            const bool contains = QString::fromStdString(StringInterner::lookup(subcategoryId)).contains(text, Qt::CaseInsensitive);
+            verdict = verdicts.emplace(subcategoryId, contains).first;
+        }
+        if (verdict->second) {
+            matches.push_back(position);
+        }
+    }
+    return matches;
+}
+
+quint32 Ledger::appendColumns(const Transaction &transaction) {
+    const quint32 position = static_cast<quint32>(ids.size());
+    ids.push_back(transaction.getId());
+    userIds.push_back(transaction.getUserId());
+    days.push_back(transaction.getDay());
+    amounts.push_back(transaction.getAmount());
+    netAmounts.emplace_back();
+    signedNetAmounts.emplace_back();
+    incomeFlags.push_back(transaction.isIncomeTransaction() ? 1 : 0);
+    taxWithheldFlags.push_back(transaction.isTaxWithheld() ? 1 : 0);
+    taxAmounts.push_back(transaction.getTaxAmount());
+    categoryIds.push_back(transaction.getCategoryId());
+    subcategoryIds.push_back(transaction.getSubcategoryId());
+    typeIds.push_back(transaction.getTypeId());
+    removedFlags.push_back(0);
+    return position;
+}
+
+void Ledger::reserveColumns(size_t count) {
+    // Loads add one page at a time; growing by exactly a page would copy every column per page
+    if (count <= ids.capacity()) {
+        return;
+    }
+    count = std::max(count, ids.capacity() * 2);
+    ids.reserve(count);
+    userIds.reserve(count);
+    days.reserve(count);
+    amounts.reserve(count);
+    netAmounts.reserve(count);
+    signedNetAmounts.reserve(count);
+    incomeFlags.reserve(count);
+    taxWithheldFlags.reserve(count);
+    taxAmounts.reserve(count);
+    categoryIds.reserve(count);
+    subcategoryIds.reserve(count);
+    typeIds.reserve(count);
+    removedFlags.reserve(count);
+}
+
+void Ledger::indexPosition(quint32 position) {
+    // Loads arrive in date order, so the new position normally goes at the end
+    const int day = days[position];
+    if (dateOrder.empty() || days[dateOrder.back()] <= day) {
+        dateOrder.push_back(position);
+    } else {
+        auto pos = std::upper_bound(dateOrder.begin(), dateOrder.end(), day,
+                                    [this](int d, quint32 other) { return d < days[other]; });
+        dateOrder.insert(pos, position);
+    }
+
+    netByDay.add(day, signedNetAmounts[position]);
+    addToBitmaps(position);
+    recordInserted(position);
+}
+
+void Ledger::recordInserted(quint32 position) {
+    if (!pending.reset) {
+        pending.inserted.push_back(position);
+    }
+}
+
+void Ledger::recordRemoved(quint32 position) {
+    // Rows added since the last notification were never reported; they are dropped from
+    // pending.inserted on delivery or compaction instead
+    if (!pending.reset && position < pendingFirstPosition) {
+        pending.removedIds.push_back(ids[position]);
+    }
+}
+
+void Ledger::publish() {
+    ++currentVersion;
+    pending.toVersion = currentVersion;
+    if (batchDepth == 0) {
+        deliver();
+    }
+}
+
+void Ledger::deliver() {
+    if (pending.toVersion == pending.fromVersion) {
+        return;
+    }
+
+    Change change;
+    change.fromVersion = pending.fromVersion;
+    change.toVersion = pending.toVersion;
+    change.reset = pending.reset;
+    change.removedIds.swap(pending.removedIds);
+    change.inserted.reserve(pending.inserted.size());
+    for (quint32 position : pending.inserted) {
+        if (!removedFlags[position]) {
+            change.inserted.push_back(position);
+        }
+    }
+    pending = Change();
+    pending.fromVersion = currentVersion;
+    pending.toVersion = currentVersion;
+    pendingFirstPosition = static_cast<quint32>(ids.size());
+
+    // A subscriber may unsubscribe itself, so the list is copied first
+    const std::vector<std::pair<int, Subscriber>> current = subscribers;
+    for (const auto &entry : current) {
+        entry.second(change);
+    }
+}
+
+void Ledger::addToBitmaps(quint32 position) {
+    categoryRows[categoryIds[position]].add(position);
+    subcategoryRows[subcategoryIds[position]].add(position);
+    (incomeFlags[position] ? incomeRows : expenseRows).add(position);
+    (taxWithheldFlags[position] ? withheldRows : notWithheldRows).add(position);
+}
+
+void Ledger::rebuildBitmaps() {
+    categoryRows.clear();
+    subcategoryRows.clear();
+    incomeRows.clear();
+    expenseRows.clear();
+    withheldRows.clear();
+    notWithheldRows.clear();
+    for (quint32 position = 0; position < ids.size(); ++position) {
+        if (!removedFlags[position]) {
+            addToBitmaps(position);
+        }
+    }
+}
+
+void Ledger::markRemoved(quint32 position) {
+    if (incomeFlags[position]) {
+        balance -= amounts[position];
+    } else {
+        balance += amounts[position];
+    }
+    netByDay.add(days[position], -signedNetAmounts[position]);
+    recordRemoved(position);
+
+    // Empty bitmaps are dropped so the query never lists categories with no rows
+    auto category = categoryRows.find(categoryIds[position]);
+    category->second.remove(position);
+    if (category->second.isEmpty()) {
+        categoryRows.erase(category);
+    }
+    auto subcategory = subcategoryRows.find(subcategoryIds[position]);
+    subcategory->second.remove(position);
+    if (subcategory->second.isEmpty()) {
+        subcategoryRows.erase(subcategory);
+    }
+    (incomeFlags[position] ? incomeRows : expenseRows).remove(position);
+    (taxWithheldFlags[position] ? withheldRows : notWithheldRows).remove(position);
+    removedFlags[position] = 1;
+    ++removedCount;
+}
+
+void Ledger::compactIfNeeded() {
+    if (removedCount * 4 >= ids.size()) {
+        compact();
+    }
+}
+
+void Ledger::compact() {
+    // New position of every live position; removed ones are never looked up
+    std::vector<quint32> newPositions(ids.size());
+    quint32 next = 0;
+    for (size_t position = 0; position < ids.size(); ++position) {
+        newPositions[position] = next;
+        next += removedFlags[position] ? 0 : 1;
+    }
+
+    // Pending insertions are renumbered too; those removed since are dropped
+    size_t pendingKept = 0;
+    for (quint32 position : pending.inserted) {
+        if (!removedFlags[position]) {
+            pending.inserted[pendingKept++] = newPositions[position];
+        }
+    }
+    pending.inserted.resize(pendingKept);
+    pendingFirstPosition = pendingFirstPosition < ids.size() ? newPositions[pendingFirstPosition] : next;
+
+    auto squeeze = [this](auto &column) {
+        size_t kept = 0;
+        for (size_t position = 0; position < column.size(); ++position) {
+            if (!removedFlags[position]) {
+                column[kept++] = column[position];
+            }
+        }
+        column.resize(kept);
+    };
+    squeeze(ids);
+    squeeze(userIds);
+    squeeze(days);
+    squeeze(amounts);
+    squeeze(netAmounts);
+    squeeze(signedNetAmounts);
+    squeeze(incomeFlags);
+    squeeze(taxWithheldFlags);
+    squeeze(taxAmounts);
+    squeeze(categoryIds);
+    squeeze(subcategoryIds);
+    squeeze(typeIds);
+    removedFlags.assign(next, 0);
+    removedCount = 0;
+
+    for (quint32 &position : dateOrder) {
+        position = newPositions[position];
+    }
+    for (auto &entry : positionsById) {
+        entry.second = newPositions[entry.second];
+    }
+
+    // Index documents and bitmap values are positions, so both are rebuilt
+    subcategoryIndex.clear();
+    indexedCount = 0;
+    rebuildBitmaps();
 }
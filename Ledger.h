@@ -1,52 +1,352 @@
 #ifndef LEDGER_H
 #define LEDGER_H
 
+#include <QString>
+#include <QtGlobal>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <unordered_map>
 #include <vector>
+#include "BalanceIndex.h"
+#include "RoaringBitmap.h"
+#include "StringInterner.h"
 #include "Transaction.h"
+#include "TrigramIndex.h"
 
 /**
  * @brief The Ledger class manages a collection of financial transactions for a specific user and tracks the running balance.
  *
- * The Ledger class allows adding and removing transactions, retrieving all transactions,
- * calculating the current balance based on incomes and expenses, and providing utility
- * functions to display transaction details.
+ * The Ledger class allows adding and removing transactions, reading them in date order
+ * without copying, calculating the current balance based on incomes and expenses, and
+ * providing utility functions to display transaction details. Subcategories are kept in a
+ * trigram index so substring searches only look at the transactions that can match.
+ *
+ * Storage is columnar: each field lives in its own array indexed by the transaction's
+ * position, and strings are kept as StringInterner ids. Filters, sums and running
+ * balances therefore only touch the few arrays they read. Positions are
+ * assigned in the order transactions are added and never change while others are added;
+ * a separate list of positions keeps them in date order for reading. RowView gives the
+ * familiar Transaction getters on top of the columns.
+ *
+ * A hash from transaction id to position makes removal independent of the ledger size.
+ * Removed positions are only marked in the columns and dropped from the date order; once
+ * they make up a quarter of the columns, the columns are compacted in one pass.
+ *
+ * Net amounts are computed once, when a transaction is added; batches go through the
+ * SIMD kernels of AmountKernels. They are also kept per day in a BalanceIndex, so the
+ * balance as of any date and the total of any date range are answered without walking the
+ * transactions.
+ *
+ * Live positions are also kept in compressed bitmaps per category, subcategory, type and
+ * tax withholding, updated as transactions are added and removed, so LedgerQuery can
+ * combine criteria with bitmap intersections before reading any column.
+ *
+ * Every modification bumps version() and is reported to subscribers as a Change listing
+ * the rows added and the ids removed. Between beginBatch() and endBatch() changes are
+ * coalesced, so a bulk load reaches the views as one Change rather than one per row.
  */
 class Ledger {
 public:
+    /**
+     * @brief Read-only view of one transaction in the ledger's columns.
+     *
+     * Has the same getters as Transaction, so code written against a Transaction works on a
+     * row. A RowView is valid until the ledger is next modified.
+     */
+    class RowView {
+    public:
+        RowView(const Ledger *ledger, quint32 position) : ledger(ledger), position(position) {}
+
+        int getId() const { return ledger->ids[position]; }
+        int getUserId() const { return ledger->userIds[position]; }
+        int getDay() const { return ledger->days[position]; }
+        std::string getDate() const { return DateUtil::format(getDay()); }
+        const std::string &getCategory() const { return StringInterner::lookup(getCategoryId()); }
+        quint32 getCategoryId() const { return ledger->categoryIds[position]; }
+        const std::string &getSubcategory() const { return StringInterner::lookup(getSubcategoryId()); }
+        quint32 getSubcategoryId() const { return ledger->subcategoryIds[position]; }
+        const std::string &getType() const { return StringInterner::lookup(getTypeId()); }
+        quint32 getTypeId() const { return ledger->typeIds[position]; }
+        Money getAmount() const { return ledger->amounts[position]; }
+        bool isIncomeTransaction() const { return ledger->incomeFlags[position] != 0; }
+        bool isTaxWithheld() const { return ledger->taxWithheldFlags[position] != 0; }
+        double getTaxAmount() const { return ledger->taxAmounts[position]; }
+
+        /**
+         * @brief Retrieves the amount after withheld tax, computed once when the row was added.
+         * @return The same value as Transaction::calculateNetAmount().
+         */
+        Money calculateNetAmount() const { return ledger->netAmounts[position]; }
+
+        /**
+         * @brief Retrieves the net amount signed for a balance: positive for income, negative for expenses.
+         * @return The signed net amount.
+         */
+        Money signedNetAmount() const { return ledger->signedNetAmounts[position]; }
+
+        /**
+         * @brief Retrieves the row's storage position, stable while transactions are only added.
+         * @return The position.
+         */
+        quint32 getPosition() const { return position; }
+
+        /**
+         * @brief Copies the row into a standalone Transaction.
+         * @return The transaction.
+         */
+        Transaction toTransaction() const;
+
+    private:
+        const Ledger *ledger; ///< The ledger holding the columns.
+        quint32 position;     ///< Index into the columns.
+    };
+
+    /**
+     * @brief Read-only iterator over the rows in date order.
+     */
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = RowView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = RowView;
+
+        const_iterator(const Ledger *ledger, std::vector<quint32>::const_iterator position)
+            : ledger(ledger), position(position) {}
+
+        RowView operator*() const { return RowView(ledger, *position); }
+        const_iterator &operator++() { ++position; return *this; }
+        const_iterator operator++(int) { const_iterator previous = *this; ++position; return previous; }
+        bool operator==(const const_iterator &other) const { return position == other.position; }
+        bool operator!=(const const_iterator &other) const { return position != other.position; }
+
+    private:
+        const Ledger *ledger;                           ///< The ledger being iterated.
+        std::vector<quint32>::const_iterator position;  ///< Current entry of the ledger's date order.
+    };
+
+    /**
+     * @brief The modifications made to the ledger since the previous notification.
+     *
+     * Rows added and then removed before the notification appear in neither list. When
+     * reset is set the ledger was cleared, and inserted and removedIds are empty: subscribers
+     * rebuild from the ledger's current contents instead.
+     */
+    struct Change {
+        quint64 fromVersion = 0;       ///< version() before the first modification reported.
+        quint64 toVersion = 0;         ///< version() after the last modification reported.
+        bool reset = false;            ///< true if the ledger was cleared.
+        std::vector<quint32> inserted; ///< Positions of the rows added, in the order added.
+        std::vector<int> removedIds;   ///< Ids of the rows removed that were reported before.
+    };
+
+    /**
+     * @brief Receives the changes of a ledger; must not modify the ledger.
+     */
+    using Subscriber = std::function<void(const Change &)>;
+
+    /**
+     * @brief Holds change notifications for its lifetime, like beginBatch() and endBatch().
+     */
+    class Batch {
+    public:
+        explicit Batch(Ledger &ledger) : ledger(ledger) { ledger.beginBatch(); }
+        ~Batch() { ledger.endBatch(); }
+        Batch(const Batch &) = delete;
+        Batch &operator=(const Batch &) = delete;
+
+    private:
+        Ledger &ledger; ///< The ledger whose notifications are held.
+    };
+
     /**
      * @brief Default constructor initializes an empty ledger with a zero balance.
      */
     Ledger();
 
+    /**
+     * @brief Retrieves the number of modifications made to the ledger so far.
+     *
+     * Each addTransaction(), addTransactions(), successful removal and clear() counts once.
+     *
+     * @return The version; it only increases.
+     */
+    quint64 version() const;
+
+    /**
+     * @brief Registers a callback for the ledger's changes.
+     *
+     * Callbacks run on the thread that modifies the ledger, once the modification is complete
+     * or, inside a batch, once the outermost batch ends. Subscribing does not modify the
+     * ledger, so read-only holders may subscribe.
+     *
+     * @param subscriber The callback.
+     * @return A token for unsubscribe().
+     */
+    int subscribe(Subscriber subscriber) const;
+
+    /**
+     * @brief Removes a callback registered with subscribe().
+     * @param token The token subscribe() returned; unknown tokens are ignored.
+     */
+    void unsubscribe(int token) const;
+
+    /**
+     * @brief Starts holding change notifications. Batches nest.
+     */
+    void beginBatch();
+
+    /**
+     * @brief Ends a batch; the outermost one delivers everything held as a single Change.
+     */
+    void endBatch();
+
     /**
      * @brief Adds a new transaction to the ledger and updates the running balance.
      *
+     * The transaction is placed after every transaction on the same or an earlier date. A
+     * transaction whose id is already in the ledger is ignored with a warning.
+     *
      * @param transaction The Transaction object to be added.
+     * @return The added row, or the existing row with the same id.
+     */
+    RowView addTransaction(const Transaction &transaction);
+
+    /**
+     * @brief Adds a batch of transactions, such as a page of a load, and updates the running balance.
+     *
+     * Equivalent to adding them one by one, but their net amounts and the balance change are
+     * computed by AmountKernels over the new columns, and out-of-range tax percentages are
+     * reported once per batch instead of once per row. Transactions whose id is already in the
+     * ledger, or earlier in the batch, are ignored with one warning.
+     *
+     * @param transactions The transactions, preferably in date order.
      */
-    void addTransaction(const Transaction &transaction);
+    void addTransactions(const std::vector<Transaction> &transactions);
 
     /**
      * @brief Removes a transaction from the ledger by its unique ID and updates the balance.
      *
+     * The transaction is found through the id index; only its entry in the date order is
+     * shifted out. Use removeTransactions() to remove many at once.
+     *
      * @param transactionId The unique identifier of the transaction to be removed.
      * @return `true` if the transaction was found and removed successfully, `false` otherwise.
      */
     bool removeTransaction(int transactionId);
 
+    /**
+     * @brief Removes several transactions by ID and updates the balance.
+     *
+     * Costs one pass over the date order however many transactions are removed.
+     *
+     * @param transactionIds The identifiers of the transactions to remove; unknown ids are ignored.
+     * @return The number of transactions removed.
+     */
+    size_t removeTransactions(const std::vector<int> &transactionIds);
+
     /**
      * @brief Retrieves the current running balance of the ledger.
      *
-     * @return The current balance as a double.
+     * @return The current balance, exact to the cent.
      */
-    double getBalance() const;
+    Money getBalance() const;
 
     /**
-     * @brief Retrieves all transactions stored in the ledger.
+     * @brief Retrieves the balance after every transaction on or before a day.
+     *
+     * Uses net amounts, like the running balance of the transaction table. O(log d) in the
+     * number of days covered by the ledger.
+     *
+     * @param day The day number.
+     * @return The sum of the signed net amounts through that day.
+     */
+    Money balanceAsOf(int day) const;
+
+    /**
+     * @brief Totals the signed net amounts of the transactions in a date range.
+     * @param fromDay The first day included.
+     * @param toDay The last day included.
+     * @return The total, or zero if toDay is before fromDay.
+     */
+    Money sumBetween(int fromDay, int toDay) const;
+
+    /**
+     * @brief Totals the net amounts of a list of positions, such as a run of LedgerQuery results.
+     * @param positions The positions.
+     * @param count The number of positions.
+     * @return The total of their net amounts, unsigned.
+     */
+    Money netTotal(const quint32 *positions, size_t count) const;
+
+    /**
+     * @brief Copies all transactions stored in the ledger, in date order.
+     *
+     * Prefer iterating the ledger; a copy is only needed to hand the data to another thread.
      *
      * @return A vector containing all Transaction objects.
      */
     std::vector<Transaction> getAllTransactions() const;
 
+    /**
+     * @brief Retrieves the number of transactions in the ledger.
+     * @return The transaction count.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Retrieves the highest id of the transactions in the ledger.
+     * @return The id, or 0 if the ledger is empty.
+     */
+    int maxId() const;
+
+    /**
+     * @brief Estimates the heap memory held by the ledger's columns and indexes.
+     * @return The size in bytes.
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * @brief Retrieves a row by its position in date order.
+     * @param index The position, less than size().
+     * @return The row; valid until the ledger is next modified.
+     */
+    RowView operator[](size_t index) const;
+
+    /**
+     * @brief Retrieves an iterator to the earliest transaction.
+     * @return The iterator; invalidated when the ledger is modified.
+     */
+    const_iterator begin() const;
+
+    /**
+     * @brief Retrieves the past-the-end iterator of the date order.
+     * @return The iterator; invalidated when the ledger is modified.
+     */
+    const_iterator end() const;
+
+    /**
+     * @brief Finds the transactions whose subcategory contains a text, ignoring case.
+     *
+     * Needles of three or more characters are answered from the trigram index and cost
+     * roughly the number of matches; shorter ones fall back to a scan. The index is built on
+     * the first search and extended with transactions added since on later ones, so loading
+     * a ledger does not pay for it.
+     *
+     * @param text The text to search for; an empty text matches every transaction.
+     * @return The matching rows in date order; valid until the ledger is next modified.
+     */
+    std::vector<RowView> findBySubcategory(const QString &text) const;
+
+    /**
+     * @brief Computes the balance after each row, in date order, from gross amounts.
+     * @return One balance per row of the date order.
+     */
+    std::vector<Money> runningBalances() const;
+
     /**
      * @brief Prints all transactions in the ledger (for debugging).
      */
@@ -57,11 +357,124 @@ public:
      */
     void clear();
 
+private:
+    friend class LedgerQuery;
+    friend class LedgerReport;
 
+    /**
+     * @brief Indexes the subcategories of the transactions added since the last search.
+     */
+    void updateSubcategoryIndex() const;
 
-private:
-    std::vector<Transaction> transactions; // Collection of all transactions in the ledger.
-    double balance;                        // Running balance of the ledger.
+    /**
+     * @brief Finds the live positions whose subcategory contains a text, ignoring case.
+     * @param text The text to search for.
+     * @return The positions in ascending order.
+     */
+    std::vector<quint32> subcategoryMatches(const QString &text) const;
+
+    /**
+     * @brief Appends a transaction to the columns, leaving its net amounts zero.
+     * @param transaction The transaction.
+     * @return Its position.
+     */
+    quint32 appendColumns(const Transaction &transaction);
+
+    /**
+     * @brief Reserves room in every column, at least doubling it when it grows.
+     * @param count The number of positions to make room for.
+     */
+    void reserveColumns(size_t count);
+
+    /**
+     * @brief Adds an appended position to the date order, the balance index and the bitmaps.
+     * @param position A position whose columns are complete and whose id is in positionsById.
+     */
+    void indexPosition(quint32 position);
+
+    /**
+     * @brief Adds a position to the bitmaps of its category, subcategory, type and withholding.
+     * @param position A live position.
+     */
+    void addToBitmaps(quint32 position);
+
+    /**
+     * @brief Rebuilds every bitmap from the live positions.
+     */
+    void rebuildBitmaps();
+
+    /**
+     * @brief Records an added position for the next notification.
+     * @param position The position.
+     */
+    void recordInserted(quint32 position);
+
+    /**
+     * @brief Records a removal for the next notification.
+     * @param position The removed position, before any compaction.
+     */
+    void recordRemoved(quint32 position);
+
+    /**
+     * @brief Counts a modification and notifies the subscribers unless a batch is open.
+     */
+    void publish();
+
+    /**
+     * @brief Hands the pending changes, if any, to every subscriber.
+     */
+    void deliver();
+
+    /**
+     * @brief Marks a position removed and takes its amount off the balance.
+     * @param position A position that is not removed yet.
+     */
+    void markRemoved(quint32 position);
+
+    /**
+     * @brief Compacts the columns once removed positions make up a quarter of them.
+     */
+    void compactIfNeeded();
+
+    /**
+     * @brief Drops the removed positions from the columns and renumbers the others.
+     */
+    void compact();
+
+    // Columns, one entry per transaction in the order added
+    std::vector<int> ids;                  // Transaction ids.
+    std::vector<int> userIds;              // Owning user ids.
+    std::vector<int> days;                 // Day numbers.
+    std::vector<Money> amounts;            // Gross amounts.
+    std::vector<Money> netAmounts;         // Amounts after withheld tax.
+    std::vector<Money> signedNetAmounts;   // Net amounts, negated for expenses.
+    std::vector<quint8> incomeFlags;       // 1 for income, 0 for expenses.
+    std::vector<quint8> taxWithheldFlags;  // 1 if tax was withheld.
+    std::vector<double> taxAmounts;        // Tax percentages.
+    std::vector<quint32> categoryIds;      // Interned categories.
+    std::vector<quint32> subcategoryIds;   // Interned subcategories.
+    std::vector<quint32> typeIds;          // Interned type strings.
+    std::vector<quint8> removedFlags;      // 1 once removed, until the next compaction.
+
+    std::vector<quint32> dateOrder;         // Live positions ordered by date and then by the order added.
+    std::unordered_map<int, quint32> positionsById; // Position of each live transaction id.
+    size_t removedCount;                    // Number of positions marked in removedFlags.
+    Money balance;                          // Running balance of the ledger.
+    BalanceIndex netByDay;                  // Signed net amounts per day.
+    std::unordered_map<quint32, RoaringBitmap> categoryRows;    // Live positions per interned category.
+    std::unordered_map<quint32, RoaringBitmap> subcategoryRows; // Live positions per interned subcategory.
+    RoaringBitmap incomeRows;               // Live income positions.
+    RoaringBitmap expenseRows;              // Live expense positions.
+    RoaringBitmap withheldRows;             // Live positions with tax withheld.
+    RoaringBitmap notWithheldRows;          // Live positions without tax withheld.
+    quint64 currentVersion;                 // Modifications so far.
+    int batchDepth;                         // Number of open batches.
+    Change pending;                         // Changes not delivered yet.
+    quint32 pendingFirstPosition;           // Positions from here on were added since the last notification.
+    mutable std::vector<std::pair<int, Subscriber>> subscribers; // Callbacks by token.
+    mutable int nextSubscriberToken;        // Token of the next subscribe().
+    mutable TrigramIndex subcategoryIndex;  // Subcategory trigrams; documents are positions.
+    mutable size_t indexedCount;            // Number of leading positions covered by subcategoryIndex.
 };
 
 #endif // LEDGER_H
@@ -0,0 +1,131 @@
+#include "LedgerCache.h"
+#include <QSettings>
+#include <QDebug>
+
+const qint64 LedgerCache::DefaultCapacity;
+
+qint64 LedgerCache::configuredCapacity()
+{
+    QSettings settings("Crumpet", "Unit13RA");
+    bool ok = false;
+    const qint64 capacity = settings.value("cache/ledgerBytes", DefaultCapacity).toLongLong(&ok);
+    if (!ok || capacity < 0) {
+        qWarning() << "Invalid ledger cache size" << settings.value("cache/ledgerBytes").toString()
+                   << "- using" << DefaultCapacity << "bytes";
+        return DefaultCapacity;
+    }
+    return capacity;
+}
+
+LedgerCache::LedgerCache(qint64 capacity)
+    : m_capacity(capacity)
+    , m_bytes(0)
+    , m_hits(0)
+    , m_misses(0)
+{
+}
+
+void LedgerCache::put(int userId, std::shared_ptr<Ledger> ledger, qint64 dataVersion)
+{
+    erase(userId);
+
+    const qint64 bytes = static_cast<qint64>(ledger->memoryUsage());
+    if (bytes > m_capacity) {
+        return;
+    }
+
+    Slot slot;
+    slot.userId = userId;
+    slot.entry.maxId = ledger->maxId();
+    slot.entry.ledger = std::move(ledger);
+    slot.entry.dataVersion = dataVersion;
+    slot.bytes = bytes;
+    m_slots.push_front(std::move(slot));
+    m_slotsByUser[userId] = m_slots.begin();
+    m_bytes += bytes;
+    evict();
+}
+
+LedgerCache::Entry LedgerCache::take(int userId)
+{
+    auto found = m_slotsByUser.find(userId);
+    if (found == m_slotsByUser.end()) {
+        ++m_misses;
+        return Entry();
+    }
+
+    ++m_hits;
+    Entry entry = std::move(found->second->entry);
+    erase(userId);
+    return entry;
+}
+
+void LedgerCache::reportStale()
+{
+    if (m_hits > 0) {
+        --m_hits;
+        ++m_misses;
+    }
+}
+
+void LedgerCache::clear()
+{
+    m_slots.clear();
+    m_slotsByUser.clear();
+    m_bytes = 0;
+}
+
+qint64 LedgerCache::capacity() const
+{
+    return m_capacity;
+}
+
+void LedgerCache::setCapacity(qint64 capacity)
+{
+    m_capacity = capacity;
+    evict();
+}
+
+qint64 LedgerCache::memoryUsage() const
+{
+    return m_bytes;
+}
+
+size_t LedgerCache::count() const
+{
+    return m_slots.size();
+}
+
+quint64 LedgerCache::hits() const
+{
+    return m_hits;
+}
+
+quint64 LedgerCache::misses() const
+{
+    return m_misses;
+}
+
+void LedgerCache::logStatistics() const
+{
+    qInfo() << "Ledger cache - hits:" << m_hits << "misses:" << m_misses << "ledgers:" << m_slots.size()
+            << "bytes:" << m_bytes << "of" << m_capacity;
+}
+
+void LedgerCache::erase(int userId)
+{
+    auto found = m_slotsByUser.find(userId);
+    if (found == m_slotsByUser.end()) {
+        return;
+    }
+    m_bytes -= found->second->bytes;
+    m_slots.erase(found->second);
+    m_slotsByUser.erase(found);
+}
+
+void LedgerCache::evict()
+{
+    while (m_bytes > m_capacity && !m_slots.empty()) {
+        erase(m_slots.back().userId);
+    }
+}
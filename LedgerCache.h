@@ -0,0 +1,146 @@
+#ifndef LEDGERCACHE_H
+#define LEDGERCACHE_H
+
+#include <QtGlobal>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include "Ledger.h"
+
+/**
+ * @brief The LedgerCache class keeps the ledgers of recently logged-out users in memory.
+ *
+ * A ledger is cached together with the user's ledger_versions counter read before it was
+ * loaded and the highest transaction id it holds, like a LedgerSnapshot. Logging the same
+ * user in again takes the ledger back out, indexes included, and only needs the counter
+ * to be unchanged and the rows with higher ids to be read, instead of a full reload.
+ *
+ * Ledgers are evicted least recently cached first once their estimated memory exceeds the
+ * capacity, set in bytes by the "cache/ledgerBytes" setting. The cache counts hits and
+ * misses so its effect on logins can be checked. It must only be used from one thread.
+ */
+class LedgerCache {
+public:
+    static const qint64 DefaultCapacity = 256 * 1024 * 1024; ///< Capacity if the setting is absent.
+
+    /**
+     * @brief A cached ledger and the database state it reflects.
+     */
+    struct Entry {
+        std::shared_ptr<Ledger> ledger; ///< The ledger; null if none was cached.
+        qint64 dataVersion = -1;        ///< The user's ledger_versions counter before it was loaded.
+        int maxId = 0;                  ///< Highest transaction id in the ledger.
+    };
+
+    /**
+     * @brief Retrieves the capacity selected in the application settings ("cache/ledgerBytes").
+     * @return The capacity in bytes; 0 disables the cache.
+     */
+    static qint64 configuredCapacity();
+
+    /**
+     * @brief Constructs an empty cache.
+     * @param capacity The most memory the cached ledgers may hold, in bytes.
+     */
+    explicit LedgerCache(qint64 capacity = DefaultCapacity);
+
+    /**
+     * @brief Caches a user's ledger, replacing any ledger cached for them before.
+     *
+     * The ledger must not be modified while it is cached. A ledger larger than the whole
+     * capacity is not cached.
+     *
+     * @param userId The owner of the ledger.
+     * @param ledger The completely loaded ledger.
+     * @param dataVersion The user's ledger_versions counter read before the ledger was loaded.
+     */
+    void put(int userId, std::shared_ptr<Ledger> ledger, qint64 dataVersion);
+
+    /**
+     * @brief Removes a user's ledger from the cache and hands it over, counting a hit or a miss.
+     * @param userId The user.
+     * @return The entry; its ledger is null if none was cached.
+     */
+    Entry take(int userId);
+
+    /**
+     * @brief Counts a hit of take() as a miss, once the entry turned out to be stale.
+     */
+    void reportStale();
+
+    /**
+     * @brief Removes every cached ledger.
+     */
+    void clear();
+
+    /**
+     * @brief Retrieves the capacity.
+     * @return The capacity in bytes.
+     */
+    qint64 capacity() const;
+
+    /**
+     * @brief Changes the capacity, evicting ledgers until they fit.
+     * @param capacity The capacity in bytes; 0 disables the cache.
+     */
+    void setCapacity(qint64 capacity);
+
+    /**
+     * @brief Retrieves the estimated memory held by the cached ledgers.
+     * @return The size in bytes.
+     */
+    qint64 memoryUsage() const;
+
+    /**
+     * @brief Retrieves the number of cached ledgers.
+     * @return The ledger count.
+     */
+    size_t count() const;
+
+    /**
+     * @brief Retrieves the number of take() calls that returned a current ledger.
+     * @return The hit count.
+     */
+    quint64 hits() const;
+
+    /**
+     * @brief Retrieves the number of take() calls that found no ledger or a stale one.
+     * @return The miss count.
+     */
+    quint64 misses() const;
+
+    /**
+     * @brief Logs the hit/miss counters and the memory held.
+     */
+    void logStatistics() const;
+
+private:
+    /**
+     * @brief A cached ledger with its owner and size.
+     */
+    struct Slot {
+        int userId;   ///< The owner of the ledger.
+        Entry entry;  ///< The ledger and its database state.
+        qint64 bytes; ///< Ledger::memoryUsage() when it was cached.
+    };
+
+    /**
+     * @brief Removes a user's slot, if any.
+     * @param userId The user.
+     */
+    void erase(int userId);
+
+    /**
+     * @brief Evicts the least recently cached ledgers until the rest fit the capacity.
+     */
+    void evict();
+
+    qint64 m_capacity; ///< Most bytes the cached ledgers may hold.
+    qint64 m_bytes; ///< Bytes held by the cached ledgers.
+    std::list<Slot> m_slots; ///< Cached ledgers, most recently cached first.
+    std::unordered_map<int, std::list<Slot>::iterator> m_slotsByUser; ///< Slot of each cached user.
+    quint64 m_hits; ///< take() calls that returned a current ledger.
+    quint64 m_misses; ///< take() calls that found no ledger, or a stale one.
+};
+
+#endif // LEDGERCACHE_H
@@ -0,0 +1,257 @@
+#include "LedgerQuery.h"
+#include "DateUtil.h"
+#include "StringInterner.h"
+#include <algorithm>
+
+namespace {
+
+/**
+ * @brief Keeps the positions passing a test, preserving their order.
+ */
+template <typename Test>
+void refine(std::vector<quint32> &selection, const Test &test)
+{
+    size_t kept = 0;
+    for (quint32 position : selection) {
+        if (test(position)) {
+            selection[kept++] = position;
+        }
+    }
+    selection.resize(kept);
+}
+
+} // namespace
+
+LedgerQuery::LedgerQuery()
+    : fromDay(DateUtil::MinDay)
+    , toDay(DateUtil::MaxDay)
+    , amountRestricted(false)
+    , includeIncome(true)
+    , includeExpenses(true)
+    , taxFilter(AnyTax)
+{
+}
+
+LedgerQuery &LedgerQuery::setDateRange(int fromDay, int toDay)
+{
+    this->fromDay = fromDay;
+    this->toDay = toDay;
+    return *this;
+}
+
+LedgerQuery &LedgerQuery::setAmountRange(Money minimum, Money maximum)
+{
+    amountRestricted = true;
+    minimumAmount = minimum;
+    maximumAmount = maximum;
+    return *this;
+}
+
+LedgerQuery &LedgerQuery::setCategory(const QString &category)
+{
+    categoryIds.clear();
+    if (!category.isEmpty()) {
+        categoryIds.push_back(StringInterner::intern(category.toStdString()));
+    }
+    return *this;
+}
+
+LedgerQuery &LedgerQuery::setCategories(const std::vector<quint32> &categoryIds)
+{
+    this->categoryIds = categoryIds;
+    std::sort(this->categoryIds.begin(), this->categoryIds.end());
+    this->categoryIds.erase(std::unique(this->categoryIds.begin(), this->categoryIds.end()), this->categoryIds.end());
+    return *this;
+}
+
+LedgerQuery &LedgerQuery::setSubcategoryText(const QString &text)
+{
+    subcategoryText = text;
+    return *this;
+}
+
+LedgerQuery &LedgerQuery::setTypes(bool income, bool expenses)
+{
+    includeIncome = income;
+    includeExpenses = expenses;
+    return *this;
+}
+
+LedgerQuery &LedgerQuery::setTaxFilter(TaxFilter filter)
+{
+    taxFilter = filter;
+    return *this;
+}
+
+bool LedgerQuery::isUnfiltered() const
+{
+    return fromDay == DateUtil::MinDay && toDay == DateUtil::MaxDay && !amountRestricted && categoryIds.empty()
+           && subcategoryText.isEmpty() && includeIncome && includeExpenses && taxFilter == AnyTax;
+}
+
+bool LedgerQuery::matches(const Ledger::RowView &row) const
+{
+    if (row.getDay() < fromDay || row.getDay() > toDay) {
+        return false;
+    }
+    if (amountRestricted && (row.getAmount() < minimumAmount || row.getAmount() > maximumAmount)) {
+        return false;
+    }
+    if (!categoryIds.empty() && !std::binary_search(categoryIds.begin(), categoryIds.end(), row.getCategoryId())) {
+        return false;
+    }
+    if (!(row.isIncomeTransaction() ? includeIncome : includeExpenses)) {
+        return false;
+    }
+    if (taxFilter != AnyTax && row.isTaxWithheld() != (taxFilter == TaxWithheld)) {
+        return false;
+    }
+    return subcategoryText.isEmpty()
+           || QString::fromStdString(row.getSubcategory()).contains(subcategoryText, Qt::CaseInsensitive);
+}
+
+std::vector<quint32> LedgerQuery::positions(const Ledger &ledger) const
+{
+    std::vector<quint32> selection;
+    if (toDay < fromDay || (!includeIncome && !includeExpenses)) {
+        return selection;
+    }
+
+    // The date order is sorted by day, so the date range is a slice of it
+    const std::vector<int> &days = ledger.days;
+    auto first = std::lower_bound(ledger.dateOrder.begin(), ledger.dateOrder.end(), fromDay,
+                                  [&days](quint32 position, int day) { return days[position] < day; });
+    auto last = std::upper_bound(first, ledger.dateOrder.end(), toDay,
+                                 [&days](int day, quint32 position) { return day < days[position]; });
+    const size_t rangeSize = static_cast<size_t>(last - first);
+
+    // The bitmap criteria are intersected smallest first, so the intermediate sets stay small
+    RoaringBitmap combined;
+    bool restricted = false;
+    if (!collectBitmaps(ledger, combined, restricted)) {
+        return selection;
+    }
+
+    const std::vector<Money> &amounts = ledger.amounts;
+    auto inAmountRange = [this, &amounts](quint32 position) {
+        return !amountRestricted || (amounts[position] >= minimumAmount && amounts[position] <= maximumAmount);
+    };
+
+    bool walkRange = restricted;
+    if (restricted && combined.cardinality() < rangeSize / 4) {
+        // Few matches: list them and drop those outside the ranges. Positions come out
+        // ascending, so for a ledger loaded in date order they are already in date order;
+        // otherwise a small list is sorted and a larger one left to the walk below.
+        selection = combined.toVector();
+        refine(selection, [this, &days, &inAmountRange](quint32 position) {
+            return days[position] >= fromDay && days[position] <= toDay && inAmountRange(position);
+        });
+        auto byDay = [&days](quint32 a, quint32 b) { return days[a] < days[b]; };
+        walkRange = false;
+        if (!std::is_sorted(selection.begin(), selection.end(), byDay)) {
+            if (selection.size() < rangeSize / 16) {
+                // Equal days keep ascending positions, which is the date order
+                std::stable_sort(selection.begin(), selection.end(), byDay);
+            } else {
+                walkRange = true;
+            }
+        }
+    }
+
+    if (walkRange) {
+        // Many matches: walk the date range against a plain bitmap of them
+        selection.clear();
+        const std::vector<quint64> words = combined.toWords(static_cast<quint32>(ledger.ids.size()));
+        for (auto it = first; it != last; ++it) {
+            if (((words[*it >> 6] >> (*it & 63)) & 1) && inAmountRange(*it)) {
+                selection.push_back(*it);
+            }
+        }
+    } else if (!restricted) {
+        selection.assign(first, last);
+        if (amountRestricted) {
+            refine(selection, inAmountRange);
+        }
+    }
+    return selection;
+}
+
+std::vector<Ledger::RowView> LedgerQuery::rows(const Ledger &ledger) const
+{
+    const std::vector<quint32> matched = positions(ledger);
+    std::vector<Ledger::RowView> result;
+    result.reserve(matched.size());
+    for (quint32 position : matched) {
+        result.emplace_back(&ledger, position);
+    }
+    return result;
+}
+
+bool LedgerQuery::collectBitmaps(const Ledger &ledger, RoaringBitmap &combined, bool &restricted) const
+{
+    const RoaringBitmap empty;
+    std::vector<const RoaringBitmap *> operands;
+    std::vector<RoaringBitmap> unions;
+    unions.reserve(2);
+
+    auto rowsOf = [&empty](const std::unordered_map<quint32, RoaringBitmap> &bitmaps, quint32 id) {
+        auto it = bitmaps.find(id);
+        return it != bitmaps.end() ? &it->second : &empty;
+    };
+
+    if (categoryIds.size() == 1) {
+        operands.push_back(rowsOf(ledger.categoryRows, categoryIds.front()));
+    } else if (!categoryIds.empty()) {
+        unions.emplace_back();
+        for (quint32 id : categoryIds) {
+            unions.back() |= *rowsOf(ledger.categoryRows, id);
+        }
+        operands.push_back(&unions.back());
+    }
+
+    if (!subcategoryText.isEmpty()) {
+        unions.emplace_back();
+        if (ledger.subcategoryRows.size() * 4 <= ledger.size()) {
+            // Subcategories repeat, so each distinct one is compared once and its rows added whole
+            for (const auto &entry : ledger.subcategoryRows) {
+                const QString subcategory = QString::fromStdString(StringInterner::lookup(entry.first));
+                if (subcategory.contains(subcategoryText, Qt::CaseInsensitive)) {
+                    unions.back() |= entry.second;
+                }
+            }
+        } else {
+            // Mostly distinct subcategories: the trigram index finds the rows faster
+            for (quint32 position : ledger.subcategoryMatches(subcategoryText)) {
+                unions.back().add(position);
+            }
+        }
+        operands.push_back(&unions.back());
+    }
+
+    if (includeIncome != includeExpenses) {
+        operands.push_back(includeIncome ? &ledger.incomeRows : &ledger.expenseRows);
+    }
+    if (taxFilter != AnyTax) {
+        operands.push_back(taxFilter == TaxWithheld ? &ledger.withheldRows : &ledger.notWithheldRows);
+    }
+
+    restricted = !operands.empty();
+    if (!restricted) {
+        return true;
+    }
+
+    std::vector<std::pair<size_t, const RoaringBitmap *>> bySize;
+    for (const RoaringBitmap *operand : operands) {
+        bySize.emplace_back(operand->cardinality(), operand);
+    }
+    std::sort(bySize.begin(), bySize.end(),
+              [](const std::pair<size_t, const RoaringBitmap *> &a, const std::pair<size_t, const RoaringBitmap *> &b) {
+                  return a.first < b.first;
+              });
+
+    combined = *bySize.front().second;
+    for (size_t i = 1; i < bySize.size() && !combined.isEmpty(); ++i) {
+        combined &= *bySize[i].second;
+    }
+    return !combined.isEmpty();
+}
@@ -0,0 +1,144 @@
+#ifndef LEDGERQUERY_H
+#define LEDGERQUERY_H
+
+#include <QString>
+#include <QtGlobal>
+#include <vector>
+#include "Ledger.h"
+#include "Money.h"
+#include "RoaringBitmap.h"
+
+/**
+ * @brief The LedgerQuery class selects the transactions of a Ledger that match a set of criteria.
+ *
+ * Criteria are combined with AND; any left unset match everything. A query is evaluated
+ * over sets of positions rather than row by row:
+ *  - the category set, subcategory text, type and tax criteria are read from the ledger's
+ *    bitmaps (a category set or the subcategories containing the text are united first) and
+ *    intersected smallest first;
+ *  - the date range is a binary search on the ledger's date order. When the intersection is
+ *    small next to the range, its positions are listed (and, unless the ledger was loaded
+ *    in date order, sorted by date); otherwise the range is walked against the
+ *    intersection expanded to a plain bitmap;
+ *  - the amount range, which no bitmap covers, filters what remains from the amount column.
+ *
+ * Results are position lists or row views in date order; no transaction is copied.
+ */
+class LedgerQuery {
+public:
+    /**
+     * @brief Whether matching transactions had tax withheld.
+     */
+    enum TaxFilter {
+        AnyTax,        ///< Either.
+        TaxWithheld,   ///< Only transactions with tax withheld.
+        NoTaxWithheld  ///< Only transactions without tax withheld.
+    };
+
+    /**
+     * @brief Constructs a query that matches every transaction.
+     */
+    LedgerQuery();
+
+    /**
+     * @brief Restricts matches to an inclusive range of days.
+     * @param fromDay The first day included; DateUtil::MinDay for no lower bound.
+     * @param toDay The last day included; DateUtil::MaxDay for no upper bound.
+     * @return This query.
+     */
+    LedgerQuery &setDateRange(int fromDay, int toDay);
+
+    /**
+     * @brief Restricts matches to an inclusive range of gross amounts.
+     * @param minimum The smallest amount included.
+     * @param maximum The largest amount included.
+     * @return This query.
+     */
+    LedgerQuery &setAmountRange(Money minimum, Money maximum);
+
+    /**
+     * @brief Restricts matches to a single category.
+     * @param category The category; empty for any.
+     * @return This query.
+     */
+    LedgerQuery &setCategory(const QString &category);
+
+    /**
+     * @brief Restricts matches to a set of categories.
+     * @param categoryIds StringInterner ids of the categories; empty for any.
+     * @return This query.
+     */
+    LedgerQuery &setCategories(const std::vector<quint32> &categoryIds);
+
+    /**
+     * @brief Restricts matches to subcategories containing a text, ignoring case.
+     * @param text The text; empty for any.
+     * @return This query.
+     */
+    LedgerQuery &setSubcategoryText(const QString &text);
+
+    /**
+     * @brief Restricts matches by transaction type.
+     * @param income Whether income matches.
+     * @param expenses Whether expenses match.
+     * @return This query.
+     */
+    LedgerQuery &setTypes(bool income, bool expenses);
+
+    /**
+     * @brief Restricts matches by tax withholding.
+     * @param filter The withholding to match.
+     * @return This query.
+     */
+    LedgerQuery &setTaxFilter(TaxFilter filter);
+
+    /**
+     * @brief Checks whether any criterion is set.
+     * @return true if the query matches every transaction, false otherwise.
+     */
+    bool isUnfiltered() const;
+
+    /**
+     * @brief Checks a single row against every criterion.
+     * @param row The row.
+     * @return true if the row matches, false otherwise.
+     */
+    bool matches(const Ledger::RowView &row) const;
+
+    /**
+     * @brief Evaluates the query.
+     * @param ledger The ledger to search.
+     * @return The ledger positions of the matches, in date order.
+     */
+    std::vector<quint32> positions(const Ledger &ledger) const;
+
+    /**
+     * @brief Evaluates the query.
+     * @param ledger The ledger to search.
+     * @return The matching rows in date order; valid until the ledger is next modified.
+     */
+    std::vector<Ledger::RowView> rows(const Ledger &ledger) const;
+
+private:
+    /**
+     * @brief Intersects the ledger bitmaps of the category, subcategory, type and tax criteria.
+     * @param ledger The ledger whose bitmaps are read.
+     * @param combined Receives the positions matching every such criterion.
+     * @param restricted Receives whether any such criterion is set; combined is left empty if not.
+     * @return false if a criterion is set and nothing matches, true otherwise.
+     */
+    bool collectBitmaps(const Ledger &ledger, RoaringBitmap &combined, bool &restricted) const;
+
+    int fromDay;                       ///< First day matched.
+    int toDay;                         ///< Last day matched.
+    bool amountRestricted;             ///< Whether minimumAmount and maximumAmount apply.
+    Money minimumAmount;               ///< Smallest gross amount matched.
+    Money maximumAmount;               ///< Largest gross amount matched.
+    std::vector<quint32> categoryIds;  ///< Interned categories matched, sorted; empty for any.
+    QString subcategoryText;           ///< Subcategory substring; empty for any.
+    bool includeIncome;                ///< Whether income matches.
+    bool includeExpenses;              ///< Whether expenses match.
+    TaxFilter taxFilter;               ///< Withholding matched.
+};
+
+#endif // LEDGERQUERY_H
@@ -0,0 +1,262 @@
+#include "LedgerReport.h"
+#include "DateUtil.h"
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+
+const size_t MinimumRowsPerThread = 65536; // Smaller slices cost more to hand out than to aggregate
+const size_t MaxDenseSlots = 1 << 20;       // 32 MiB of partials across all threads; wider reports use hash maps
+const int MaxDayTableSize = 1 << 20;        // Wider date ranges compute months per row
+const int CategoryPageBits = 12;            // Category ids per page of the index table, as a power of two
+const quint32 CategoryPageSize = 1u << CategoryPageBits;
+
+/**
+ * @brief Running aggregates of one group in cents.
+ */
+struct Partial {
+    qint64 count = 0;
+    qint64 sum = 0;
+    qint64 minimum = std::numeric_limits<qint64>::max();
+    qint64 maximum = std::numeric_limits<qint64>::min();
+
+    void add(qint64 cents)
+    {
+        ++count;
+        sum += cents;
+        minimum = std::min(minimum, cents);
+        maximum = std::max(maximum, cents);
+    }
+
+    void merge(const Partial &other)
+    {
+        count += other.count;
+        sum += other.sum;
+        minimum = std::min(minimum, other.minimum);
+        maximum = std::max(maximum, other.maximum);
+    }
+};
+
+int monthNumber(int day)
+{
+    int year = 0;
+    int month = 0;
+    int dayOfMonth = 0;
+    DateUtil::toCivil(day, year, month, dayOfMonth);
+    return year * 12 + month - 1;
+}
+
+/**
+ * @brief Maps a row's day, category and type to a group key.
+ *
+ * Keys are ((month offset * category count) + category index) * 2 + income, so ascending
+ * keys are ordered by month, category id and type, and dense keys index a flat array.
+ */
+struct KeyLayout {
+    int firstDay = 0;
+    int firstMonth = 0;
+    quint64 monthCount = 0;
+    std::vector<int> monthByDay;                     // Month offset per day from firstDay; empty if the range is too wide
+    std::vector<quint32> categories;                 // Category ids in ascending order
+    std::vector<std::vector<quint32>> categoryPages; // Index into categories per id from categories.front(), by page
+
+    quint64 slotCount() const { return monthCount * categories.size() * 2; }
+
+    quint64 categoryIndex(quint32 categoryId) const
+    {
+        const quint32 offset = categoryId - categories.front();
+        return categoryPages[offset >> CategoryPageBits][offset & (CategoryPageSize - 1)];
+    }
+
+    quint64 key(int day, quint32 categoryId, quint8 income) const
+    {
+        const int monthOffset = monthByDay.empty() ? monthNumber(day) - firstMonth : monthByDay[day - firstDay];
+        return (static_cast<quint64>(monthOffset) * categories.size() + categoryIndex(categoryId)) * 2
+               + (income ? 1 : 0);
+    }
+};
+
+/**
+ * @brief Runs work(0) .. work(count - 1) in parallel, work(0) on the calling thread.
+ */
+void runParallel(int count, const std::function<void(int)> &work)
+{
+    QSemaphore finished;
+    for (int slice = 1; slice < count; ++slice) {
+        QThreadPool::globalInstance()->start([&work, &finished, slice]() {
+            work(slice);
+            finished.release();
+        });
+    }
+    work(0);
+    finished.acquire(count - 1);
+}
+
+} // namespace
+
+Money LedgerReport::Group::mean() const
+{
+    if (count == 0) {
+        return Money();
+    }
+    // Rounds half away from zero, like Money::percentage()
+    const qint64 cents = sum.toCents();
+    const qint64 half = cents < 0 ? -count : count;
+    return Money::fromCents((2 * cents + half) / (2 * count));
+}
+
+std::vector<LedgerReport::Group> LedgerReport::byMonthAndCategory(const Ledger &ledger, int threadCount)
+{
+    return aggregate(ledger, nullptr, threadCount);
+}
+
+std::vector<LedgerReport::Group> LedgerReport::byMonthAndCategory(const Ledger &ledger,
+                                                                  const std::vector<quint32> &positions,
+                                                                  int threadCount)
+{
+    return aggregate(ledger, &positions, threadCount);
+}
+
+std::vector<LedgerReport::Group> LedgerReport::aggregate(const Ledger &ledger, const std::vector<quint32> *positions,
+                                                         int threadCount)
+{
+    std::vector<Group> groups;
+    if (ledger.dateOrder.empty() || (positions && positions->empty())) {
+        return groups;
+    }
+
+    // The date order gives the live range directly; a subset needs a pass over its days
+    int firstDay = ledger.days[ledger.dateOrder.front()];
+    int lastDay = ledger.days[ledger.dateOrder.back()];
+    if (positions) {
+        auto range = std::minmax_element(positions->begin(), positions->end(), [&ledger](quint32 a, quint32 b) {
+            return ledger.days[a] < ledger.days[b];
+        });
+        firstDay = ledger.days[*range.first];
+        lastDay = ledger.days[*range.second];
+    }
+
+    KeyLayout layout;
+    layout.firstDay = firstDay;
+    layout.firstMonth = monthNumber(firstDay);
+    layout.monthCount = static_cast<quint64>(monthNumber(lastDay) - layout.firstMonth) + 1;
+    if (static_cast<qint64>(lastDay) - firstDay < MaxDayTableSize) {
+        layout.monthByDay.resize(static_cast<size_t>(lastDay - firstDay) + 1);
+        for (size_t i = 0; i < layout.monthByDay.size(); ++i) {
+            layout.monthByDay[i] = monthNumber(firstDay + static_cast<int>(i)) - layout.firstMonth;
+        }
+    }
+
+    // Every live category has a bitmap, so its keys are the categories to index
+    for (const auto &entry : ledger.categoryRows) {
+        layout.categories.push_back(entry.first);
+    }
+    std::sort(layout.categories.begin(), layout.categories.end());
+
+    // Ids are interned process-wide, so the ledger's categories may be spread over millions of
+    // ids; only the pages of the table that hold one of them are allocated
+    const quint32 categorySpan = layout.categories.back() - layout.categories.front();
+    layout.categoryPages.resize((categorySpan >> CategoryPageBits) + 1);
+    for (size_t i = 0; i < layout.categories.size(); ++i) {
+        const quint32 offset = layout.categories[i] - layout.categories.front();
+        std::vector<quint32> &page = layout.categoryPages[offset >> CategoryPageBits];
+        if (page.empty()) {
+            page.resize(CategoryPageSize);
+        }
+        page[offset & (CategoryPageSize - 1)] = static_cast<quint32>(i);
+    }
+
+    const size_t rowCount = positions ? positions->size() : ledger.ids.size();
+    if (threadCount <= 0) {
+        threadCount = QThread::idealThreadCount();
+    }
+    int sliceCount = static_cast<int>(
+        std::max<size_t>(1, std::min<size_t>(static_cast<size_t>(threadCount), rowCount / MinimumRowsPerThread)));
+
+    // Each slice zeroes and merges every dense slot, so dense partials are used only while every
+    // slice has at least as many rows as slots and all slices together fit the budget. Fewer
+    // slices are used rather than hash maps when only that keeps them dense: a hash map per
+    // slice is several times slower than one dense array.
+    const quint64 slotCount = layout.slotCount();
+    const quint64 denseSlices = std::min<quint64>({static_cast<quint64>(sliceCount), rowCount / slotCount,
+                                                   MaxDenseSlots / slotCount});
+    const bool dense = denseSlices > 0;
+    if (dense) {
+        sliceCount = static_cast<int>(denseSlices);
+    }
+
+    // Visits the rows of one slice; each slice writes only its own partials
+    auto visitSlice = [&ledger, &layout, positions, rowCount, sliceCount](int slice, auto &&partialFor) {
+        const size_t begin = rowCount * static_cast<size_t>(slice) / static_cast<size_t>(sliceCount);
+        const size_t end = rowCount * static_cast<size_t>(slice + 1) / static_cast<size_t>(sliceCount);
+        for (size_t i = begin; i < end; ++i) {
+            const quint32 position = positions ? (*positions)[i] : static_cast<quint32>(i);
+            if (!positions && ledger.removedFlags[position]) {
+                continue;
+            }
+            partialFor(layout.key(ledger.days[position], ledger.categoryIds[position], ledger.incomeFlags[position]))
+                .add(ledger.netAmounts[position].toCents());
+        }
+    };
+
+    auto appendGroup = [&groups, &layout](quint64 key, const Partial &partial) {
+        const quint64 categorySlot = key >> 1;
+        Group group;
+        group.month = layout.firstMonth + static_cast<int>(categorySlot / layout.categories.size());
+        group.categoryId = layout.categories[categorySlot % layout.categories.size()];
+        group.income = (key & 1) != 0;
+        group.count = partial.count;
+        group.sum = Money::fromCents(partial.sum);
+        group.minimum = Money::fromCents(partial.minimum);
+        group.maximum = Money::fromCents(partial.maximum);
+        groups.push_back(group);
+    };
+
+    if (dense) {
+        std::vector<std::vector<Partial>> partials(static_cast<size_t>(sliceCount));
+        runParallel(sliceCount, [&](int slice) {
+            std::vector<Partial> &own = partials[static_cast<size_t>(slice)];
+            own.resize(static_cast<size_t>(slotCount));
+            visitSlice(slice, [&own](quint64 key) -> Partial & { return own[static_cast<size_t>(key)]; });
+        });
+
+        std::vector<Partial> &merged = partials.front();
+        for (size_t slice = 1; slice < partials.size(); ++slice) {
+            for (size_t key = 0; key < merged.size(); ++key) {
+                merged[key].merge(partials[slice][key]);
+            }
+        }
+        for (size_t key = 0; key < merged.size(); ++key) {
+            if (merged[key].count > 0) {
+                appendGroup(key, merged[key]);
+            }
+        }
+    } else {
+        std::vector<std::unordered_map<quint64, Partial>> partials(static_cast<size_t>(sliceCount));
+        runParallel(sliceCount, [&](int slice) {
+            std::unordered_map<quint64, Partial> &own = partials[static_cast<size_t>(slice)];
+            visitSlice(slice, [&own](quint64 key) -> Partial & { return own[key]; });
+        });
+
+        std::unordered_map<quint64, Partial> &merged = partials.front();
+        for (size_t slice = 1; slice < partials.size(); ++slice) {
+            for (const auto &entry : partials[slice]) {
+                merged[entry.first].merge(entry.second);
+            }
+        }
+        std::vector<std::pair<quint64, Partial>> sorted(merged.begin(), merged.end());
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const std::pair<quint64, Partial> &a, const std::pair<quint64, Partial> &b) {
+                      return a.first < b.first;
+                  });
+        for (const auto &entry : sorted) {
+            appendGroup(entry.first, entry.second);
+        }
+    }
+    return groups;
+}
@@ -0,0 +1,70 @@
+#ifndef LEDGERREPORT_H
+#define LEDGERREPORT_H
+
+#include <QtGlobal>
+#include <vector>
+#include "Ledger.h"
+#include "Money.h"
+
+/**
+ * @brief The LedgerReport class aggregates a Ledger's net amounts per month, category and type.
+ *
+ * The rows are split into contiguous slices of the ledger's columns, one per thread of
+ * QThreadPool::globalInstance() (the calling thread takes the first). Each thread fills
+ * its own partial aggregates without locking, and the partials are merged once all
+ * threads are done. Partials are flat arrays indexed by (month, category, type) when every
+ * thread has at least as many rows as the array has slots and all the arrays fit a fixed
+ * budget, with fewer threads if that is what it takes, and hash maps otherwise.
+ * Month numbers come from a per-day lookup table, so no calendar arithmetic is done per row.
+ */
+class LedgerReport {
+public:
+    /**
+     * @brief The aggregates of one (month, category, type) group.
+     */
+    struct Group {
+        int month;          ///< Months since year 0: year * 12 + (month of year - 1).
+        quint32 categoryId; ///< Interned category.
+        bool income;        ///< true for income, false for expenses.
+        qint64 count;       ///< Number of transactions.
+        Money sum;          ///< Total net amount.
+        Money minimum;      ///< Smallest net amount.
+        Money maximum;      ///< Largest net amount.
+
+        int year() const { return month / 12; }
+        int monthOfYear() const { return month % 12 + 1; }
+
+        /**
+         * @brief Computes the mean net amount, rounded to the nearest cent.
+         * @return The mean.
+         */
+        Money mean() const;
+    };
+
+    /**
+     * @brief Aggregates every transaction of a ledger.
+     * @param ledger The ledger; it must not be modified while the report runs.
+     * @param threadCount The number of threads to use, or 0 for QThread::idealThreadCount().
+     * @return One group per (month, category, type) with transactions, ordered by month,
+     *         category id and then type, expenses first.
+     */
+    static std::vector<Group> byMonthAndCategory(const Ledger &ledger, int threadCount = 0);
+
+    /**
+     * @brief Aggregates a subset of a ledger, such as the matches of a LedgerQuery.
+     * @param ledger The ledger; it must not be modified while the report runs.
+     * @param positions Live positions of the ledger, in any order.
+     * @param threadCount The number of threads to use, or 0 for QThread::idealThreadCount().
+     * @return The groups, ordered as by byMonthAndCategory(ledger).
+     */
+    static std::vector<Group> byMonthAndCategory(const Ledger &ledger, const std::vector<quint32> &positions,
+                                                 int threadCount = 0);
+
+private:
+    /**
+     * @brief Aggregates either a list of positions or, if positions is null, every live position.
+     */
+    static std::vector<Group> aggregate(const Ledger &ledger, const std::vector<quint32> *positions, int threadCount);
+};
+
+#endif // LEDGERREPORT_H
@@ -0,0 +1,314 @@
+#include "LedgerSnapshot.h"
+#include "StatementCache.h"
+#include "StringInterner.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVariant>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+const char kMagic[8] = {'P', 'F', 'M', 'L', 'E', 'D', 'G', 'R'};
+
+/**
+ * @brief The fixed-size file header. The body follows: records, string entries, string bytes.
+ */
+struct Header {
+    char magic[8];          ///< kMagic.
+    quint32 formatVersion;  ///< LedgerSnapshot::FormatVersion.
+    qint32 userId;          ///< Owner of the transactions.
+    qint64 dataVersion;     ///< The user's ledger_versions counter when written.
+    qint32 maxId;           ///< Highest transaction id in the file, 0 if empty.
+    quint32 recordCount;    ///< Number of records.
+    quint32 stringCount;    ///< Number of dictionary strings.
+    quint32 reserved;       ///< Zero.
+    quint64 stringBytes;    ///< Size of the UTF-8 string data.
+    quint64 checksum;       ///< LedgerSnapshot::checksum() of the body.
+    quint64 reserved2;      ///< Zero.
+};
+static_assert(sizeof(Header) == 64, "snapshot header layout");
+
+/**
+ * @brief One transaction; strings are indexes into the dictionary.
+ */
+struct Record {
+    qint32 id;
+    qint32 day;
+    qint64 amountCents;
+    double taxAmount;
+    quint32 category;
+    quint32 subcategory;
+    quint32 type;
+    quint32 taxWithheld;
+};
+static_assert(sizeof(Record) == 40, "snapshot record layout");
+
+/**
+ * @brief Location of one dictionary string within the string data.
+ */
+struct StringEntry {
+    quint32 offset;
+    quint32 length;
+};
+
+bool byDayThenId(const Transaction &a, const Transaction &b)
+{
+    return a.getDay() != b.getDay() ? a.getDay() < b.getDay() : a.getId() < b.getId();
+}
+
+// NOT INDEXED leaves SQLite only the rowid range, instead of walking the user's whole
+// (userId, day) index when just a few rows are newer than the snapshot; they are sorted in a temp b-tree.
+const char *const kNewerRowsSql =
+    "SELECT id, userId, day, category, subcategory, amountCents, type, taxWithheld, taxAmount "
+    "FROM transactions NOT INDEXED WHERE id > :afterId AND userId = :userId ORDER BY day ASC, id ASC";
+
+} // namespace
+
+QString LedgerSnapshot::pathFor(const QSqlDatabase &db, int userId)
+{
+    return QFileInfo(db.databaseName()).absoluteDir().filePath(QString("snapshots/ledger-%1.bin").arg(userId));
+}
+
+bool LedgerSnapshot::load(QSqlDatabase &db, int userId, std::vector<Transaction> &transactions, int *newerRows)
+{
+    transactions.clear();
+    if (newerRows) {
+        *newerRows = 0;
+    }
+
+    QFile file(pathFor(db, userId));
+    if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const qint64 size = file.size();
+    if (size < static_cast<qint64>(sizeof(Header))) {
+        qWarning() << "Ignoring truncated ledger snapshot" << file.fileName();
+        return false;
+    }
+    uchar *data = file.map(0, size);
+    if (!data) {
+        qWarning() << "Failed to map ledger snapshot" << file.fileName() << ":" << file.errorString();
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+    const qint64 expectedSize = static_cast<qint64>(sizeof(Header))
+                                + static_cast<qint64>(header.recordCount) * static_cast<qint64>(sizeof(Record))
+                                + static_cast<qint64>(header.stringCount) * static_cast<qint64>(sizeof(StringEntry))
+                                + static_cast<qint64>(header.stringBytes);
+
+    auto reject = [&](const char *reason) {
+        qWarning() << "Ignoring ledger snapshot" << file.fileName() << ":" << reason;
+        file.unmap(data);
+        transactions.clear();
+        return false;
+    };
+
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.formatVersion != FormatVersion) {
+        return reject("unknown format");
+    }
+    if (header.userId != userId || expectedSize != size) {
+        return reject("header does not match the file");
+    }
+    if (checksum(data + sizeof(Header), size - static_cast<qint64>(sizeof(Header))) != header.checksum) {
+        return reject("checksum mismatch");
+    }
+
+    const qint64 currentVersion = dataVersion(db, userId);
+    if (currentVersion != header.dataVersion) {
+        qInfo() << "Ledger snapshot of user" << userId << "is stale; reloading from the database";
+        file.unmap(data);
+        return false;
+    }
+
+    // Rows added since the snapshot was written. Read before the records so the vector is sized
+    // once; appending them afterwards would move every record to a larger buffer.
+    std::vector<Transaction> newer;
+    if (!readNewerRows(db, userId, header.maxId, newer)) {
+        file.unmap(data);
+        return false;
+    }
+
+    // Intern each distinct string once; records then only copy ids
+    const uchar *recordData = data + sizeof(Header);
+    const uchar *entryData = recordData + static_cast<qint64>(header.recordCount) * static_cast<qint64>(sizeof(Record));
+    const char *stringData = reinterpret_cast<const char *>(entryData)
+                             + static_cast<qint64>(header.stringCount) * static_cast<qint64>(sizeof(StringEntry));
+
+    std::vector<quint32> strings;
+    strings.reserve(header.stringCount);
+    for (quint32 i = 0; i < header.stringCount; ++i) {
+        StringEntry entry;
+        std::memcpy(&entry, entryData + i * sizeof(StringEntry), sizeof(StringEntry));
+        if (static_cast<quint64>(entry.offset) + entry.length > header.stringBytes) {
+            return reject("string out of range");
+        }
+        strings.push_back(StringInterner::intern(std::string(stringData + entry.offset, entry.length)));
+    }
+
+    transactions.reserve(static_cast<size_t>(header.recordCount) + newer.size());
+    for (quint32 i = 0; i < header.recordCount; ++i) {
+        Record record;
+        std::memcpy(&record, recordData + static_cast<qint64>(i) * static_cast<qint64>(sizeof(Record)), sizeof(Record));
+        if (record.category >= header.stringCount || record.subcategory >= header.stringCount
+            || record.type >= header.stringCount) {
+            return reject("string index out of range");
+        }
+        transactions.emplace_back();
+        Transaction &t = transactions.back();
+        t.setId(record.id);
+        t.setUserId(userId);
+        t.setDay(record.day);
+        t.setCategoryId(strings[record.category]);
+        t.setSubcategoryId(strings[record.subcategory]);
+        t.setAmount(Money::fromCents(record.amountCents));
+        t.setTypeId(strings[record.type]);
+        t.setTaxWithheld(record.taxWithheld != 0);
+        t.setTaxAmount(record.taxAmount);
+    }
+    file.unmap(data);
+
+    const size_t snapshotRows = transactions.size();
+    transactions.insert(transactions.end(), newer.begin(), newer.end());
+
+    const size_t added = newer.size();
+    if (added > 0 && snapshotRows > 0 && byDayThenId(transactions[snapshotRows], transactions[snapshotRows - 1])) {
+        // Backdated additions; both halves are sorted already
+        std::inplace_merge(transactions.begin(), transactions.begin() + static_cast<std::ptrdiff_t>(snapshotRows),
+                           transactions.end(), byDayThenId);
+    }
+    if (newerRows) {
+        *newerRows = static_cast<int>(added);
+    }
+    return true;
+}
+
+bool LedgerSnapshot::write(QSqlDatabase &db, int userId, qint64 dataVersion, std::vector<Transaction> transactions)
+{
+    if (dataVersion < 0) {
+        return false;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(Header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.formatVersion = FormatVersion;
+    header.userId = userId;
+    header.dataVersion = dataVersion;
+
+    if (!std::is_sorted(transactions.begin(), transactions.end(), byDayThenId)) {
+        std::sort(transactions.begin(), transactions.end(), byDayThenId);
+    }
+
+    // Maps interned ids to the file's own dictionary
+    std::unordered_map<quint32, quint32> stringIds;
+    std::vector<StringEntry> entries;
+    std::string stringBytes;
+    auto intern = [&](quint32 id) {
+        auto inserted = stringIds.emplace(id, static_cast<quint32>(entries.size()));
+        if (inserted.second) {
+            const std::string &text = StringInterner::lookup(id);
+            entries.push_back({static_cast<quint32>(stringBytes.size()), static_cast<quint32>(text.size())});
+            stringBytes += text;
+        }
+        return inserted.first->second;
+    };
+
+    std::vector<Record> records;
+    records.reserve(transactions.size());
+    for (const Transaction &t : transactions) {
+        Record record;
+        std::memset(&record, 0, sizeof(Record));
+        record.id = t.getId();
+        record.day = t.getDay();
+        record.amountCents = t.getAmount().toCents();
+        record.taxAmount = t.getTaxAmount();
+        record.category = intern(t.getCategoryId());
+        record.subcategory = intern(t.getSubcategoryId());
+        record.type = intern(t.getTypeId());
+        record.taxWithheld = t.isTaxWithheld() ? 1 : 0;
+        records.push_back(record);
+        header.maxId = std::max(header.maxId, record.id);
+    }
+
+    header.recordCount = static_cast<quint32>(records.size());
+    header.stringCount = static_cast<quint32>(entries.size());
+    header.stringBytes = stringBytes.size();
+
+    QByteArray body;
+    body.reserve(static_cast<int>(records.size() * sizeof(Record) + entries.size() * sizeof(StringEntry) + stringBytes.size()));
+    body.append(reinterpret_cast<const char *>(records.data()), static_cast<int>(records.size() * sizeof(Record)));
+    body.append(reinterpret_cast<const char *>(entries.data()), static_cast<int>(entries.size() * sizeof(StringEntry)));
+    body.append(stringBytes.data(), static_cast<int>(stringBytes.size()));
+    header.checksum = checksum(reinterpret_cast<const uchar *>(body.constData()), body.size());
+
+    const QString path = pathFor(db, userId);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)
+        || file.write(reinterpret_cast<const char *>(&header), sizeof(Header)) != static_cast<qint64>(sizeof(Header))
+        || file.write(body) != body.size()
+        || !file.commit()) {
+        qWarning() << "Failed to write ledger snapshot" << path << ":" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool LedgerSnapshot::readNewerRows(QSqlDatabase &db, int userId, int afterId, std::vector<Transaction> &transactions)
+{
+    StatementCache &cache = StatementCache::forDatabase(db);
+    QSqlQuery &query = cache.prepare(kNewerRowsSql);
+    query.bindValue(":afterId", afterId);
+    query.bindValue(":userId", userId);
+    if (!cache.exec(query)) {
+        qWarning() << "Failed to read newer transactions:" << query.lastError().text();
+        return false;
+    }
+
+    while (query.next()) {
+        transactions.push_back(Transaction::fromQuery(query));
+    }
+    query.finish();
+    return true;
+}
+
+qint64 LedgerSnapshot::dataVersion(QSqlDatabase &db, int userId)
+{
+    StatementCache &cache = StatementCache::forDatabase(db);
+    QSqlQuery &query = cache.prepare("SELECT version FROM ledger_versions WHERE userId = :userId");
+    query.bindValue(":userId", userId);
+    if (!cache.exec(query)) {
+        qWarning() << "Failed to read the ledger version:" << query.lastError().text();
+        return -1;
+    }
+    const qint64 version = query.next() ? query.value(0).toLongLong() : 0;
+    query.finish();
+    return version;
+}
+
+quint64 LedgerSnapshot::checksum(const uchar *data, qint64 size)
+{
+    // Eight bytes per step through a multiply-xorshift mix; fast enough to check on every load
+    quint64 hash = 0x9E3779B97F4A7C15ULL ^ static_cast<quint64>(size);
+    qint64 i = 0;
+    for (; i + 8 <= size; i += 8) {
+        quint64 word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,90 @@
+#ifndef LEDGERSNAPSHOT_H
+#define LEDGERSNAPSHOT_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <vector>
+#include "Transaction.h"
+
+/**
+ * @brief The LedgerSnapshot class stores a user's transactions in a binary file for fast logins.
+ *
+ * A snapshot holds fixed-width records plus a dictionary of the distinct category,
+ * subcategory and type strings, so loading it is a memory map and one pass over the records
+ * instead of converting every field of every row through SQLite and QVariant.
+ *
+ * A snapshot records the highest transaction id it contains and the user's ledger_versions
+ * counter, which triggers raise on every update and delete. It is used only if that counter
+ * still matches; transactions added since are recognised by their higher ids and read from
+ * the database. A checksum over the file body guards against truncated or damaged files.
+ *
+ * Snapshots are a cache: a missing, stale or invalid file only means the ledger is read from
+ * the database instead. Files use the host's byte order.
+ */
+class LedgerSnapshot {
+public:
+    static const quint32 FormatVersion = 1; ///< Version of the file layout; older files are ignored.
+
+    /**
+     * @brief Retrieves the snapshot file of a user, stored next to the database file.
+     * @param db The database the snapshot belongs to.
+     * @param userId The user.
+     * @return The file path.
+     */
+    static QString pathFor(const QSqlDatabase &db, int userId);
+
+    /**
+     * @brief Loads a user's transactions from their snapshot plus any newer rows in the database.
+     * @param db An open database connection.
+     * @param userId The user whose transactions are loaded.
+     * @param transactions Receives the transactions ordered by (day, id).
+     * @param newerRows If not null, receives the number of rows read from the database.
+     * @return true if a valid snapshot was used, false if the ledger must be read from the database.
+     */
+    static bool load(QSqlDatabase &db, int userId, std::vector<Transaction> &transactions, int *newerRows = nullptr);
+
+    /**
+     * @brief Writes a user's snapshot, replacing the previous one atomically.
+     *
+     * Must be given every transaction of the user up to the highest id among them, as they
+     * were when the user's change counter had the given value. The counter is read by the
+     * caller before loading the transactions: read here, it could already include an update
+     * the transactions do not, and the stale file would then be loaded as current.
+     *
+     * @param db An open database connection; the file is stored next to it.
+     * @param userId The user whose transactions are written.
+     * @param dataVersion The user's ledger_versions counter read before the transactions were loaded.
+     * @param transactions The user's transactions, in any order.
+     * @return true if the file was written, false otherwise.
+     */
+    static bool write(QSqlDatabase &db, int userId, qint64 dataVersion, std::vector<Transaction> transactions);
+
+    /**
+     * @brief Reads the transactions a user added after a copy of their ledger was taken.
+     * @param db An open database connection.
+     * @param userId The user.
+     * @param afterId The highest transaction id in the copy.
+     * @param transactions Receives the rows with higher ids, appended in (day, id) order.
+     * @return true if the rows were read, false on a query error.
+     */
+    static bool readNewerRows(QSqlDatabase &db, int userId, int afterId, std::vector<Transaction> &transactions);
+
+    /**
+     * @brief Reads a user's change counter from ledger_versions.
+     * @param db An open database connection.
+     * @param userId The user.
+     * @return The counter, 0 if the user's rows were never updated or deleted, or -1 on error.
+     */
+    static qint64 dataVersion(QSqlDatabase &db, int userId);
+
+private:
+    /**
+     * @brief Computes the checksum stored in the header over the file body.
+     * @param data The body.
+     * @param size The body size in bytes.
+     * @return The checksum.
+     */
+    static quint64 checksum(const uchar *data, qint64 size);
+};
+
+#endif // LEDGERSNAPSHOT_H
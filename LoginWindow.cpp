@@ -9,10 +9,33 @@
 #include "user.h"
 #include "userlogin.h"
 #include "PasswordManager.h"
+#include "StatementCache.h"
 
-LoginWindow::LoginWindow() {}
+namespace {
 
-LoginWindow::LoginWindow(QSqlDatabase db, QWidget *parent) :
+/**
+ * @brief Outcome of the login lookup, produced on the database thread.
+ */
+struct LoginLookup {
+    QString error;          ///< Database error text, if any.
+    bool loginFound = false; ///< True if the username/password pair matched.
+    bool userFound = false;  ///< True if the matching User row exists.
+    User user;              ///< The user who logged in.
+};
+
+/**
+ * @brief Outcome of a password reset, produced on the database thread.
+ */
+struct PasswordReset {
+    QString error;           ///< Database error text, if any.
+    bool userExists = false; ///< True if the username exists.
+};
+
+} // namespace
+
+LoginWindow::LoginWindow() : m_db(nullptr) {}
+
+LoginWindow::LoginWindow(DatabaseService *db, QWidget *parent) :
     QWidget(parent),
     ui(new Ui::LoginWindow),
     m_db(db),
@@ -48,51 +71,67 @@ void LoginWindow::on_logInPushButton_clicked()
         return;
     }
 
-    QSqlQuery query(m_db);
-    query.prepare("SELECT loginID, userID, accessLevel FROM UserLogin WHERE username=? AND password=?");
-    query.addBindValue(username);
-    query.addBindValue(password); // Use hashed password
+    setBusy(true);
+    m_db->submit<LoginLookup>(this, [username, password](QSqlDatabase &db) {
+        LoginLookup lookup;
+        StatementCache &cache = StatementCache::forDatabase(db);
+        QSqlQuery &query = cache.prepare("SELECT loginID, userID, accessLevel FROM UserLogin WHERE username=? AND password=?");
+        query.addBindValue(username);
+        query.addBindValue(password); // Use hashed password
+
+        if (!cache.exec(query)) {
+            lookup.error = query.lastError().text();
+            return lookup;
+        }
 
-    if (!query.exec()) {
-        QMessageBox::critical(this, "Error", "Database query error: " + query.lastError().text());
-        return;
-    }
+        if (!query.next()) {
+            return lookup;
+        }
 
-    if (query.next()) {
+        lookup.loginFound = true;
         int loginID = query.value("loginID").toInt();
         int userID = query.value("userID").toInt();
         int accessLevel = query.value("accessLevel").toInt();
+        query.finish();
 
         UserLogin userLogin(loginID, username, password, accessLevel, userID);
 
-        QSqlQuery userQuery(m_db);
-        userQuery.prepare("SELECT firstname, lastname, position FROM User WHERE userID=?");
+        QSqlQuery &userQuery = cache.prepare("SELECT firstname, lastname, position FROM User WHERE userID=?");
         userQuery.addBindValue(userLogin.getUserId());
 
-        if (!userQuery.exec()) {
-            QMessageBox::critical(this, "Error", "Database query error: " + userQuery.lastError().text());
-            return;
+        if (!cache.exec(userQuery)) {
+            lookup.error = userQuery.lastError().text();
+            return lookup;
         }
 
         if (userQuery.next()) {
-            QString firstname = userQuery.value("firstname").toString();
-            QString lastname  = userQuery.value("lastname").toString();
-            QString position  = userQuery.value("position").toString();
-
-            User user(userLogin.getUserId(), firstname, lastname, position);
-
+            lookup.userFound = true;
+            lookup.user = User(userLogin.getUserId(),
+                               userQuery.value("firstname").toString(),
+                               userQuery.value("lastname").toString(),
+                               userQuery.value("position").toString());
+            userQuery.finish();
+        }
+        return lookup;
+    }, [this](LoginLookup lookup) {
+        setBusy(false);
+
+        if (!lookup.error.isEmpty()) {
+            QMessageBox::critical(this, "Error", "Database query error: " + lookup.error);
+        } else if (!lookup.loginFound) {
+            QMessageBox::warning(this, "Error", "Invalid username or password. Please try again.");
+            ui->usernameLineEdit->clear();
+            ui->passwordLineEdit->clear();
+        } else if (!lookup.userFound) {
+            QMessageBox::warning(this, "Error", "User data not found for this userID.");
+        } else {
             // If remember me is checked, save credentials
             saveCredentials();
 
+            const User &user = lookup.user;
             emit loginSuccess(user.getFirstName(), user.getLastName(), user.getPosition());
-        } else {
-            QMessageBox::warning(this, "Error", "User data not found for this userID.");
         }
-    } else {
-        QMessageBox::warning(this, "Error", "Invalid username or password. Please try again.");
-        ui->usernameLineEdit->clear();
-        ui->passwordLineEdit->clear();
-    }
+    });
 }
 
 bool LoginWindow::eventFilter(QObject *obj, QEvent *event)
@@ -115,33 +154,47 @@ void LoginWindow::forgotPasswordClicked()
         return; // user cancelled
     }
 
-    QSqlQuery query(m_db);
-    query.prepare("SELECT loginID FROM UserLogin WHERE username=?");
-    query.addBindValue(username.trimmed());
+    const QString trimmedUsername = username.trimmed();
+    const QString tempPlainPassword = "temp123";
+    const QString newPassword = m_passwordManager->hashPassword(tempPlainPassword); // Hash the temp password
 
-    if (!query.exec()) {
-        QMessageBox::critical(this, "Error", "Query failed: " + query.lastError().text());
-        return;
-    }
+    setBusy(true);
+    m_db->submit<PasswordReset>(this, [trimmedUsername, newPassword](QSqlDatabase &db) {
+        PasswordReset reset;
+        StatementCache &cache = StatementCache::forDatabase(db);
+        QSqlQuery &query = cache.prepare("SELECT loginID FROM UserLogin WHERE username=?");
+        query.addBindValue(trimmedUsername);
 
-    if (query.next()) {
-        QString tempPlainPassword = "temp123";
-        QString newPassword = m_passwordManager->hashPassword(tempPlainPassword); // Hash the temp password
+        if (!cache.exec(query)) {
+            reset.error = "Query failed: " + query.lastError().text();
+            return reset;
+        }
+
+        reset.userExists = query.next();
+        query.finish();
+        if (!reset.userExists) {
+            return reset;
+        }
 
-        QSqlQuery updateQuery(m_db);
-        updateQuery.prepare("UPDATE UserLogin SET password=? WHERE username=?");
+        QSqlQuery &updateQuery = cache.prepare("UPDATE UserLogin SET password=? WHERE username=?");
         updateQuery.addBindValue(newPassword);
-        updateQuery.addBindValue(username.trimmed());
+        updateQuery.addBindValue(trimmedUsername);
 
-        if (!updateQuery.exec()) {
-            QMessageBox::critical(this, "Error", "Failed to reset password: " + updateQuery.lastError().text());
-            return;
+        if (!cache.exec(updateQuery)) {
+            reset.error = "Failed to reset password: " + updateQuery.lastError().text();
         }
-
-        QMessageBox::information(this, "Password Reset", "Your new password is: " + tempPlainPassword);
-    } else {
-        QMessageBox::warning(this, "Error", "Username does not exist.");
-    }
+        return reset;
+    }, [this, tempPlainPassword](PasswordReset reset) {
+        setBusy(false);
+
+        if (!reset.error.isEmpty()) {
+            QMessageBox::critical(this, "Error", reset.error);
+        } else if (reset.userExists) {
+            QMessageBox::information(this, "Password Reset", "Your new password is: " + tempPlainPassword);
+        } else {
+            QMessageBox::warning(this, "Error", "Username does not exist.");
+        }
+    });
 }
 
 void LoginWindow::saveCredentials()
@@ -169,6 +222,12 @@ void LoginWindow::loadCredentials()
     }
 }
 
+void LoginWindow::setBusy(bool busy)
+{
+    ui->logInPushButton->setEnabled(!busy);
+    setCursor(busy ? Qt::BusyCursor : Qt::ArrowCursor);
+}
+
 void LoginWindow::resetUI()
 {
     ui->usernameLineEdit->clear();
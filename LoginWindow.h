@@ -2,8 +2,8 @@
 #define LOGINWINDOW_H
 
 #include <QWidget>
-#include <QSqlDatabase>
 #include "PasswordManager.h"
+#include "DatabaseService.h"
 
 namespace Ui {
 class LoginWindow;
@@ -25,11 +25,11 @@ public:
 
     /**
      * @brief Constructs the LoginWindow.
-     * @param db The database connection reference.
+     * @param db The database service that runs the login queries.
      * @param parent The parent widget.
      * @return A LoginWindow object.
      */
-    explicit LoginWindow(QSqlDatabase db, QWidget *parent = nullptr);
+    explicit LoginWindow(DatabaseService *db, QWidget *parent = nullptr);
 
     /**
      * @brief Destructs the LoginWindow.
@@ -85,8 +85,14 @@ private:
      */
     void loadCredentials();
 
+    /**
+     * @brief Shows or clears the busy state while a database request is running.
+     * @param busy true while a request is outstanding.
+     */
+    void setBusy(bool busy);
+
     Ui::LoginWindow *ui; ///< Pointer to the UI components of LoginWindow.
-    QSqlDatabase m_db; ///< Database connection reference.
+    DatabaseService *m_db; ///< Database service running the login queries.
     PasswordManager *m_passwordManager; ///< Manages password hashing
 };
 
@@ -3,77 +3,129 @@
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QMessageBox>
-#include <QDateTime>
+#include <QFileDialog>
+#include <QProgressDialog>
 #include <algorithm>
+#include <memory>
 #include <QDebug>
 #include "Transaction.h"
+#include "Database.h"
+#include "CsvImporter.h"
+#include "StatementCache.h"
+#include "TransactionCursor.h"
+#include "DateUtil.h"
+#include "DailyTotals.h"
+#include "LedgerCache.h"
+#include "LedgerSnapshot.h"
 #include "ViewTransactions.h"
 
+namespace {
+
+/**
+ * @brief One page of the ledger load, read on the database thread.
+ */
+struct LedgerPage {
+    std::vector<Transaction> transactions;  ///< The page's rows in (date, id) order.
+    TransactionCursor::Position position;   ///< Key of the page's last row.
+    bool atEnd = true;                      ///< True if no further pages remain.
+    QString error;                          ///< Query error text, if any.
+};
+
+/**
+ * @brief The ledger as read from the user's snapshot file, on the database thread.
+ */
+struct SnapshotLoad {
+    std::vector<Transaction> transactions; ///< Snapshot rows plus newer rows, in (date, id) order.
+    bool loaded = false;                   ///< False if there was no usable snapshot.
+    int newerRows = 0;                     ///< Rows read from the database because they are newer than the snapshot.
+    qint64 dataVersion = -1;               ///< The user's ledger_versions counter, read before anything else.
+};
+
+/**
+ * @brief The outcome of checking a cached ledger against the database, on the database thread.
+ */
+struct LedgerValidation {
+    std::vector<Transaction> newerRows; ///< Rows added since the ledger was cached, in (day, id) order.
+    bool current = false;               ///< True if the ledger_versions counter is unchanged and the rows were read.
+};
+
+/**
+ * @brief The rows a CSV import added, read on the database thread.
+ */
+struct ImportedRows {
+    std::vector<Transaction> transactions; ///< Rows with ids above the ledger's, in (day, id) order.
+    bool ok = false;                       ///< True if the rows were read.
+};
+
+/**
+ * @brief The current user's daily_totals rows, read on the database thread.
+ */
+struct DailyTotalsResult {
+    std::vector<DailyTotals::Row> rows; ///< Rows ordered by day, category and type.
+    bool ok = false;                    ///< True if the rows were read.
+};
+
+/**
+ * @brief The current user's details shown on the Settings page.
+ */
+struct SettingsData {
+    bool found = false; ///< True if the user row was found.
+    QString username;   ///< Login name.
+    QString firstname;  ///< First name.
+    QString lastname;   ///< Last name.
+    QString position;   ///< Position.
+};
+
+} // namespace
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
+    , dbService(nullptr)
+    , ledgerGeneration(0)
+    , ledgerLoading(false)
     , loginWindow(nullptr)
     , signUpWindow(nullptr)
     , transactionForm(nullptr)
     , graphView(nullptr)
     , settings(nullptr)
     , viewTransactions(nullptr)
+    , ledger(std::make_shared<Ledger>())
+    , ledgerDataVersion(-1)
+    , ledgerCache(LedgerCache::configuredCapacity())
 {
     ui->setupUi(this);
 
-    // Initialize and open the database
-    m_db = QSqlDatabase::addDatabase("QSQLITE");
-    m_db.setDatabaseName("app.db");
-    if (!m_db.open()) {
-        qCritical() << "Failed to open database:" << m_db.lastError().text();
-        QMessageBox::critical(this, "Database Error", m_db.lastError().text());
-        return;
-    }
-
-    // Ensure necessary tables exist
-    {
-        QSqlQuery query(m_db);
-        if (!query.exec("CREATE TABLE IF NOT EXISTS User ("
-                        "userID INTEGER PRIMARY KEY AUTOINCREMENT,"
-                        "firstname TEXT NOT NULL,"
-                        "lastname TEXT NOT NULL,"
-                        "position TEXT NOT NULL)")) {
-            QMessageBox::critical(this, "DB Error", query.lastError().text());
+    // All SQL runs on the service's worker thread; results come back through callbacks
+    dbService = new DatabaseService(Database::defaultPath(), this);
+    connect(dbService, &DatabaseService::opened, this, [this](bool ok, const QString &error) {
+        if (!ok) {
+            QMessageBox::critical(this, "Database Error", error);
         }
-
-        if (!query.exec("CREATE TABLE IF NOT EXISTS UserLogin ("
-                        "loginID INTEGER PRIMARY KEY AUTOINCREMENT,"
-                        "username TEXT UNIQUE NOT NULL,"
-                        "password TEXT NOT NULL,"
-                        "accessLevel INTEGER NOT NULL,"
-                        "userID INTEGER NOT NULL,"
-                        "FOREIGN KEY(userID) REFERENCES User(userID))")) {
-            QMessageBox::critical(this, "DB Error", query.lastError().text());
-        }
-
-        // Transactions table
-        if (!query.exec("CREATE TABLE IF NOT EXISTS transactions ("
-                        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                        "userId INTEGER NOT NULL, "
-                        "date TEXT NOT NULL, "
-                        "category TEXT NOT NULL, "
-                        "subcategory TEXT, "
-                        "amount REAL NOT NULL, "
-                        "type TEXT NOT NULL, "
-                        "taxWithheld INTEGER NOT NULL DEFAULT 0, "
-                        "taxAmount REAL NOT NULL DEFAULT 0.0, "
-                        "FOREIGN KEY(userId) REFERENCES User(userID))")) {
-            qCritical() << "Failed to create transactions table:" << query.lastError().text();
+    });
+    connect(dbService, &DatabaseService::busyChanged, this, [this](bool busy) {
+        if (busy) {
+            setCursor(Qt::BusyCursor);
+            if (ui->statusbar->currentMessage().isEmpty()) {
+                ui->statusbar->showMessage("Working...");
+            }
+        } else {
+            unsetCursor();
+            ui->statusbar->clearMessage();
         }
-    }
+    });
+    dbService->open();
 
     // Instantiate widgets
-    loginWindow = new LoginWindow(m_db, this);
-    signUpWindow = new SignUpWindow(m_db, this);
+    loginWindow = new LoginWindow(dbService, this);
+    signUpWindow = new SignUpWindow(dbService, this);
     transactionForm = new TransactionForm(this);
+    transactionForm->setDatabaseService(dbService);
     graphView = new GraphView(this);
     settings = new Settings(this);
     viewTransactions = new ViewTransactions(this);
+    graphView->setLedger(ledger);
+    viewTransactions->setLedger(ledger);
 
     // Add them to the stacked widget
     ui->stackedWidget->addWidget(loginWindow);
@@ -92,6 +144,7 @@ MainWindow::MainWindow(QWidget *parent)
     ui->navComboBox->addItem("View Transactions");
     ui->navComboBox->addItem("View Graphs");
     ui->navComboBox->addItem("Add Transaction");
+    ui->navComboBox->addItem("Import CSV");
     ui->navComboBox->addItem("Settings");
     ui->navComboBox->addItem("Logout");
 
@@ -104,7 +157,7 @@ MainWindow::MainWindow(QWidget *parent)
     connect(signUpWindow, &SignUpWindow::showLogin, this, &MainWindow::showLoginWindow);
 
     // Transaction signals
-    connect(transactionForm, &TransactionForm::transactionSaved, this, &MainWindow::reloadLedger);
+    connect(transactionForm, &TransactionForm::transactionSaved, this, &MainWindow::onTransactionSaved);
     connect(transactionForm, &TransactionForm::transactionSaved, this, &MainWindow::showViewTransactions);
     connect(transactionForm, &TransactionForm::transactionCancelled, this, &MainWindow::showViewTransactions);
 
@@ -122,37 +175,35 @@ MainWindow::~MainWindow()
 
 void MainWindow::onLoginSuccess(const QString &firstname, const QString &lastname, const QString &position)
 {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT userID FROM User WHERE firstname=? AND lastname=? AND position=? ORDER BY userID DESC LIMIT 1");
-    query.addBindValue(firstname);
-    query.addBindValue(lastname);
-    query.addBindValue(position);
-    if (!query.exec() || !query.next()) {
-        QMessageBox::critical(this, "Error", "Failed to identify user.");
-        return;
-    }
-    int userID = query.value(0).toInt();
-
-    currentUser = User(userID, firstname, lastname, position);
-
-    // Load this user's transactions
-    ledger.clear();
-    std::vector<Transaction> allTransactions = Transaction::readAllTransactions();
-    for (const auto &t : allTransactions) {
-        if (t.getUserId() == currentUser.getUserId()) {
-            ledger.addTransaction(t);
+    dbService->submit<int>(this, [firstname, lastname, position](QSqlDatabase &db) {
+        StatementCache &cache = StatementCache::forDatabase(db);
+        QSqlQuery &query = cache.prepare("SELECT userID FROM User WHERE firstname=? AND lastname=? AND position=? ORDER BY userID DESC LIMIT 1");
+        query.addBindValue(firstname);
+        query.addBindValue(lastname);
+        query.addBindValue(position);
+        if (!cache.exec(query) || !query.next()) {
+            return 0;
+        }
+        int userID = query.value(0).toInt();
+        query.finish();
+        return userID;
+    }, [this, firstname, lastname, position](int userID) {
+        if (userID == 0) {
+            QMessageBox::critical(this, "Error", "Failed to identify user.");
+            return;
         }
-    }
-
-    transactionForm->setCurrentUser(currentUser);
 
-    viewTransactions->setCurrentUser(currentUser);
-    viewTransactions->setAllTransactions(ledger.getAllTransactions());
+        currentUser = User(userID, firstname, lastname, position);
 
-    graphView->setCurrentUser(currentUser);
-    graphView->setAllTransactions(ledger.getAllTransactions());
+        transactionForm->setCurrentUser(currentUser);
+        viewTransactions->setCurrentUser(currentUser);
+        graphView->setCurrentUser(currentUser);
 
-    showViewTransactions();
+        // Reuse the ledger cached at this user's last logout, or load their transactions page
+        // by page behind the (initially empty) views
+        restoreLedger();
+        showViewTransactions();
+    });
 }
 
 void MainWindow::showSignUpWindow()
@@ -241,48 +292,317 @@ void MainWindow::showSettings()
 QVector<QPointF> MainWindow::getDataPointsForGraph()
 {
     QVector<QPointF> dataPoints;
-    auto userTransactions = ledger.getAllTransactions();
+    dataPoints.reserve(static_cast<int>(ledger->size()));
+
+    // Balances come from one pass over the amount and type columns
+    const std::vector<Money> balances = ledger->runningBalances();
+    int currentDay = DateUtil::InvalidDay;
+    qint64 currentMSecs = 0;
+    size_t index = 0;
+    for (const auto &transaction : *ledger) {
+        // The ledger iterates in date order, so each day is converted to a timestamp only once
+        if (transaction.getDay() != currentDay) {
+            currentDay = transaction.getDay();
+            currentMSecs = DateUtil::toMSecsSinceEpoch(currentDay);
+        }
+
+        dataPoints.append(QPointF(currentMSecs, balances[index++].toDouble()));
+    }
+
+    return dataPoints;
+}
+
+void MainWindow::reloadLedger()
+{
+    // A newer load supersedes any pages of an older one still in flight
+    ++ledgerGeneration;
+    ledgerLoading = true;
+    ledgerPosition = TransactionCursor::Position();
+
+    // The views empty themselves on the reset, then see the load as one change after the
+    // first page and one when the last page is in, rather than one per page
+    ledger->clear();
+    ledgerBatch.reset();
+    ledgerBatch = std::make_unique<Ledger::Batch>(*ledger);
+    graphView->setDailyTotals({}, false);
+
+    requestLedgerSnapshot(ledgerGeneration);
+}
 
-    if (userTransactions.empty()) {
-        return dataPoints;
+void MainWindow::restoreLedger()
+{
+    const LedgerCache::Entry cached = ledgerCache.take(currentUser.getUserId());
+    if (!cached.ledger) {
+        ledgerCache.logStatistics();
+        reloadLedger();
+        return;
     }
 
-    std::sort(userTransactions.begin(), userTransactions.end(), [](const Transaction &a, const Transaction &b) {
-        return a.getDate() < b.getDate();
+    // Show the cached ledger right away; rows saved from now on are added to it as usual
+    ++ledgerGeneration;
+    ledgerLoading = false;
+    ledgerBatch.reset();
+    ledger = cached.ledger;
+    ledgerDataVersion = cached.dataVersion;
+    graphView->setLedger(ledger);
+    viewTransactions->setLedger(ledger);
+
+    requestLedgerValidation(ledgerGeneration, cached.dataVersion, cached.maxId);
+}
+
+void MainWindow::requestLedgerValidation(int generation, qint64 dataVersion, int maxId)
+{
+    const int userId = currentUser.getUserId();
+
+    dbService->submit<LedgerValidation>(this, [userId, dataVersion, maxId](QSqlDatabase &db) {
+        LedgerValidation validation;
+        validation.current = LedgerSnapshot::dataVersion(db, userId) == dataVersion
+                             && LedgerSnapshot::readNewerRows(db, userId, maxId, validation.newerRows);
+        return validation;
+    }, [this, generation, userId](LedgerValidation validation) {
+        if (generation != ledgerGeneration) {
+            return;
+        }
+        if (!validation.current) {
+            qInfo() << "Cached ledger of user" << userId << "is stale; reloading from the database";
+            ledgerCache.reportStale();
+            ledgerCache.logStatistics();
+            reloadLedger();
+            return;
+        }
+
+        ledgerCache.logStatistics();
+        ledger->addTransactions(validation.newerRows);
+        requestDailyTotals(generation);
+
+        // Fold rows added by others into the snapshot, as after a snapshot load
+        if (!validation.newerRows.empty()) {
+            writeLedgerSnapshot();
+        }
     });
+}
+
+void MainWindow::stashLedger()
+{
+    ledgerBatch.reset();
+
+    // A partly loaded ledger cannot be told apart from a complete one later, so it is dropped
+    const int userId = currentUser.getUserId();
+    if (userId != 0 && !ledgerLoading && ledgerDataVersion >= 0) {
+        ledgerCache.put(userId, ledger, ledgerDataVersion);
+    }
+
+    ledger = std::make_shared<Ledger>();
+    ledgerDataVersion = -1;
+    graphView->setLedger(ledger);
+    viewTransactions->setLedger(ledger);
+}
 
-    double balance = 0.0;
-    for (const auto &transaction : userTransactions) {
-        QDateTime transactionDateTime = QDateTime::fromString(QString::fromStdString(transaction.getDate()), "yyyy-MM-dd");
-        if (!transactionDateTime.isValid()) {
-            qWarning() << "Invalid transaction date:" << QString::fromStdString(transaction.getDate());
-            continue;
+void MainWindow::requestLedgerSnapshot(int generation)
+{
+    const int userId = currentUser.getUserId();
+
+    dbService->submit<SnapshotLoad>(this, [userId](QSqlDatabase &db) {
+        SnapshotLoad load;
+        // Read first, so an update made while the ledger loads makes a cached copy stale
+        load.dataVersion = LedgerSnapshot::dataVersion(db, userId);
+        load.loaded = LedgerSnapshot::load(db, userId, load.transactions, &load.newerRows);
+        return load;
+    }, [this, generation](SnapshotLoad load) {
+        if (generation != ledgerGeneration) {
+            return;
+        }
+        ledgerDataVersion = load.dataVersion;
+        if (!load.loaded) {
+            requestLedgerPage(generation);
+            return;
         }
 
-        if (transaction.isIncomeTransaction()) {
-            balance += transaction.getAmount();
-        } else {
-            balance -= transaction.getAmount();
+        ledger->addTransactions(load.transactions);
+        ledgerLoading = false;
+        ledgerBatch.reset();
+        requestDailyTotals(generation);
+
+        // Fold rows added since the snapshot into it, so the next login reads none of them from SQL
+        if (load.newerRows > 0) {
+            writeLedgerSnapshot();
         }
+    });
+}
 
-        dataPoints.append(QPointF(transactionDateTime.toMSecsSinceEpoch(), balance));
+void MainWindow::writeLedgerSnapshot()
+{
+    // Stamped with the counter read before the load, not the one current when the job runs,
+    // so an update made by another process meanwhile leaves the snapshot stale
+    const qint64 dataVersion = ledgerDataVersion;
+    if (dataVersion < 0) {
+        return;
     }
 
-    return dataPoints;
+    const int userId = currentUser.getUserId();
+    auto transactions = std::make_shared<std::vector<Transaction>>(ledger->getAllTransactions());
+
+    // The copy is handed over in a shared_ptr so the job can move it into the writer
+    dbService->submit(this, [userId, dataVersion, transactions](QSqlDatabase &db) {
+        LedgerSnapshot::write(db, userId, dataVersion, std::move(*transactions));
+    });
 }
 
-void MainWindow::reloadLedger()
+void MainWindow::requestLedgerPage(int generation)
+{
+    const int userId = currentUser.getUserId();
+    const TransactionCursor::Position position = ledgerPosition;
+
+    dbService->submit<LedgerPage>(this, [userId, position](QSqlDatabase &db) {
+        LedgerPage page;
+        TransactionCursor cursor(db, userId);
+        cursor.seek(position);
+        cursor.fetchNext(page.transactions);
+        page.position = cursor.position();
+        page.atEnd = cursor.atEnd();
+        page.error = cursor.lastError();
+        return page;
+    }, [this, generation](LedgerPage page) {
+        if (generation != ledgerGeneration) {
+            return;
+        }
+
+        const bool firstPage = ledger->size() == 0;
+        ledger->addTransactions(page.transactions);
+        ledgerPosition = page.position;
+
+        if (!page.error.isEmpty()) {
+            ledgerLoading = false;
+            ledgerDataVersion = -1;
+            QMessageBox::warning(this, "Error", "Failed to load all transactions: " + page.error);
+        } else if (page.atEnd) {
+            ledgerLoading = false;
+            requestDailyTotals(generation);
+            writeLedgerSnapshot();
+        }
+
+        // Show the first page right away and the complete ledger once the last page is in;
+        // pages in between only grow the ledger so the views are not rebuilt per page.
+        if (firstPage || !ledgerLoading) {
+            ledgerBatch.reset();
+            if (ledgerLoading) {
+                ledgerBatch = std::make_unique<Ledger::Batch>(*ledger);
+            }
+        }
+
+        if (ledgerLoading) {
+            ui->statusbar->showMessage(QString("Loaded %1 transactions...").arg(ledger->size()));
+            requestLedgerPage(generation);
+        }
+    });
+}
+
+void MainWindow::requestImportedRows(int generation, int maxId)
+{
+    const int userId = currentUser.getUserId();
+
+    dbService->submit<ImportedRows>(this, [userId, maxId](QSqlDatabase &db) {
+        ImportedRows rows;
+        rows.ok = LedgerSnapshot::readNewerRows(db, userId, maxId, rows.transactions);
+        return rows;
+    }, [this, generation](ImportedRows rows) {
+        if (generation != ledgerGeneration) {
+            return;
+        }
+        if (!rows.ok) {
+            reloadLedger();
+            return;
+        }
+        if (rows.transactions.empty()) {
+            return;
+        }
+
+        // The views see the whole import as one change, however many rows it added
+        {
+            Ledger::Batch batch(*ledger);
+            ledger->addTransactions(rows.transactions);
+        }
+        writeLedgerSnapshot();
+    });
+}
+
+void MainWindow::requestDailyTotals(int generation)
 {
-    ledger.clear();
-    std::vector<Transaction> allTransactions = Transaction::readAllTransactions();
-    for (const auto &t : allTransactions) {
-        if (t.getUserId() == currentUser.getUserId()) {
-            ledger.addTransaction(t);
+    const int userId = currentUser.getUserId();
+
+    dbService->submit<DailyTotalsResult>(this, [userId](QSqlDatabase &db) {
+        DailyTotalsResult result;
+        result.ok = DailyTotals::readForUser(db, userId, result.rows);
+        return result;
+    }, [this, generation](DailyTotalsResult result) {
+        // On failure the graph keeps aggregating the transactions themselves
+        if (generation == ledgerGeneration && result.ok) {
+            graphView->setDailyTotals(result.rows);
         }
+    });
+}
+
+void MainWindow::onTransactionSaved(const Transaction &transaction)
+{
+    // While the ledger is still loading, a row sorting after the last page read will arrive
+    // with a later page, so adding it here would count it twice.
+    if (ledgerLoading && (transaction.getDay() > ledgerPosition.day ||
+                          (transaction.getDay() == ledgerPosition.day && transaction.getId() > ledgerPosition.id))) {
+        return;
+    }
+
+    // The views patch themselves in from the ledger's change
+    ledger->addTransaction(transaction);
+}
+
+void MainWindow::importCsv()
+{
+    QString path = QFileDialog::getOpenFileName(this, "Import CSV", QString(), "CSV files (*.csv);;All files (*)");
+    if (path.isEmpty()) {
+        return;
     }
 
-    viewTransactions->setAllTransactions(ledger.getAllTransactions());
-    graphView->setAllTransactions(ledger.getAllTransactions());
+    // The import runs on the database thread; its signals arrive here queued
+    CsvImporter *importer = new CsvImporter(currentUser.getUserId(), this);
+
+    QProgressDialog *progressDialog = new QProgressDialog("Importing transactions...", "Cancel", 0, 1000, this);
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->setMinimumDuration(500);
+    progressDialog->setAutoReset(false);
+
+    connect(importer, &CsvImporter::progress, progressDialog, [progressDialog](qint64 bytesRead, qint64 totalBytes) {
+        progressDialog->setValue(totalBytes > 0 ? static_cast<int>(bytesRead * 1000 / totalBytes) : 1000);
+    });
+    // cancel() only sets an atomic flag, so it is safe to call while the worker is parsing
+    connect(progressDialog, &QProgressDialog::canceled, importer, &CsvImporter::cancel);
+
+    dbService->submit<CsvImporter::Result>(this, [importer, path](QSqlDatabase &db) {
+        return importer->importFile(db, path);
+    }, [this, importer, progressDialog](CsvImporter::Result result) {
+        progressDialog->reset();
+        progressDialog->deleteLater();
+        importer->deleteLater();
+
+        if (result.cancelled) {
+            QMessageBox::information(this, "Import Cancelled", "The import was cancelled. No transactions were added.");
+            return;
+        }
+        if (!result.error.isEmpty()) {
+            QMessageBox::critical(this, "Import Failed", result.error);
+            return;
+        }
+
+        // A load still in flight may or may not have passed the imported days, so it restarts;
+        // a complete ledger only needs the new rows
+        if (ledgerLoading) {
+            reloadLedger();
+        } else if (result.rowsImported > 0) {
+            requestImportedRows(ledgerGeneration, ledger->maxId());
+        }
+        QMessageBox::information(this, "Import Complete",
+                                 QString("Imported %1 of %2 rows (%3 rejected).")
+                                     .arg(result.rowsImported).arg(result.rowsRead).arg(result.rowsRejected));
+    });
 }
 
 void MainWindow::onNavComboBoxChanged(const QString &text)
@@ -299,6 +619,9 @@ void MainWindow::onNavComboBoxChanged(const QString &text)
         showViewTransactions();
     } else if (text == "View Graphs") {
         showGraphView();
+    } else if (text == "Import CSV") {
+        importCsv();
+        showViewTransactions();
     } else if (text == "Settings") {
         showSettings();
     } else if (text == "Logout") {
@@ -310,8 +633,11 @@ void MainWindow::onNavComboBoxChanged(const QString &text)
         loginWindow->resetUI();
         signUpWindow->resetUI();
 
+        stashLedger();
         currentUser = User();
-        ledger.clear();
+        ++ledgerGeneration;
+        ledgerLoading = false;
+        graphView->setDailyTotals({}, false);
         showLoginWindow();
 
         ui->navComboBox->blockSignals(true);
@@ -325,14 +651,25 @@ void MainWindow::onNavComboBoxChanged(const QString &text)
 void MainWindow::onSettingsSaved(const QString &username, const QString &password,
                                  const QString &firstName, const QString &lastName, const QString &position)
 {
-    if (updateUserInDatabase(firstName, lastName, position, username, password)) {
-        currentUser.setFirstName(firstName);
-        currentUser.setLastName(lastName);
-        currentUser.setPosition(position);
-        showViewTransactions();
-    } else {
+    const int userId = currentUser.getUserId();
+    if (userId == 0) {
+        // No user logged in
         QMessageBox::warning(this, "Error", "Failed to update user details. Please try again.");
+        return;
     }
+
+    dbService->submit<bool>(this, [userId, firstName, lastName, position, username, password](QSqlDatabase &db) {
+        return updateUserInDatabase(db, userId, firstName, lastName, position, username, password);
+    }, [this, firstName, lastName, position](bool updated) {
+        if (updated) {
+            currentUser.setFirstName(firstName);
+            currentUser.setLastName(lastName);
+            currentUser.setPosition(position);
+            showViewTransactions();
+        } else {
+            QMessageBox::warning(this, "Error", "Failed to update user details. Please try again.");
+        }
+    });
 }
 
 void MainWindow::onSettingsCancelled()
@@ -351,42 +688,38 @@ void MainWindow::updateNavVisibility()
 }
 
 
-bool MainWindow::updateUserInDatabase(const QString &firstName, const QString &lastName, const QString &position,
+bool MainWindow::updateUserInDatabase(QSqlDatabase &db, int userId,
+                                      const QString &firstName, const QString &lastName, const QString &position,
                                       const QString &username, const QString &password)
 {
-    if (currentUser.getUserId() == 0) {
-        // No user logged in
-        return false;
-    }
-
-    QSqlQuery query(m_db);
-    query.prepare("UPDATE User SET firstname=?, lastname=?, position=? WHERE userID=?");
+    StatementCache &cache = StatementCache::forDatabase(db);
+    QSqlQuery &query = cache.prepare("UPDATE User SET firstname=?, lastname=?, position=? WHERE userID=?");
     query.addBindValue(firstName);
     query.addBindValue(lastName);
     query.addBindValue(position);
-    query.addBindValue(currentUser.getUserId());
+    query.addBindValue(userId);
 
-    if (!query.exec()) {
+    if (!cache.exec(query)) {
         qWarning() << "Failed to update user table:" << query.lastError().text();
         return false;
     }
 
     // Update UserLogin info conditionally based on whether a new password was provided
-    QSqlQuery loginQuery(m_db);
+    QSqlQuery *loginQuery = nullptr;
     if (!password.isEmpty()) {
         // If password is provided, update both username and password
-        loginQuery.prepare("UPDATE UserLogin SET username=?, password=? WHERE userID=?");
-        loginQuery.addBindValue(username);
-        loginQuery.addBindValue(password); // Hashed password
+        loginQuery = &cache.prepare("UPDATE UserLogin SET username=?, password=? WHERE userID=?");
+        loginQuery->addBindValue(username);
+        loginQuery->addBindValue(password); // Hashed password
     } else {
         // If password is empty, update only the username
-        loginQuery.prepare("UPDATE UserLogin SET username=? WHERE userID=?");
-        loginQuery.addBindValue(username);
+        loginQuery = &cache.prepare("UPDATE UserLogin SET username=? WHERE userID=?");
+        loginQuery->addBindValue(username);
     }
-    loginQuery.addBindValue(currentUser.getUserId());
+    loginQuery->addBindValue(userId);
 
-    if (!loginQuery.exec()) {
-        qWarning() << "Failed to update user login:" << loginQuery.lastError().text();
+    if (!cache.exec(*loginQuery)) {
+        qWarning() << "Failed to update user login:" << loginQuery->lastError().text();
         return false;
     }
 
@@ -395,21 +728,31 @@ bool MainWindow::updateUserInDatabase(const QString &firstName, const QString &l
 
 void MainWindow::populateSettingsWithCurrentUser()
 {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT UserLogin.username, UserLogin.password, User.firstname, User.lastname, User.position "
-                  "FROM UserLogin JOIN User ON UserLogin.userID=User.userID "
-                  "WHERE User.userID=?");
-    query.addBindValue(currentUser.getUserId());
-
-    if (query.exec() && query.next()) {
-        QString username = query.value("username").toString();
-        QString firstname = query.value("firstname").toString();
-        QString lastname = query.value("lastname").toString();
-        QString position = query.value("position").toString();
-
-        settings->setUserData(username, firstname, lastname, position);
-    }
-    else {
-        qWarning() << "Failed to load user data for settings:" << query.lastError().text();
-    }
+    const int userId = currentUser.getUserId();
+    dbService->submit<SettingsData>(this, [userId](QSqlDatabase &db) {
+        SettingsData data;
+        StatementCache &cache = StatementCache::forDatabase(db);
+        QSqlQuery &query = cache.prepare("SELECT UserLogin.username, UserLogin.password, User.firstname, User.lastname, User.position "
+                                         "FROM UserLogin JOIN User ON UserLogin.userID=User.userID "
+                                         "WHERE User.userID=?");
+        query.addBindValue(userId);
+
+        if (cache.exec(query) && query.next()) {
+            data.found = true;
+            data.username = query.value("username").toString();
+            data.firstname = query.value("firstname").toString();
+            data.lastname = query.value("lastname").toString();
+            data.position = query.value("position").toString();
+
+            query.finish();
+        }
+        else {
+            qWarning() << "Failed to load user data for settings:" << query.lastError().text();
+        }
+        return data;
+    }, [this](SettingsData data) {
+        if (data.found) {
+            settings->setUserData(data.username, data.firstname, data.lastname, data.position);
+        }
+    });
 }
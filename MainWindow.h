@@ -3,6 +3,8 @@
 
 #include <QMainWindow>
 #include <QSqlDatabase>
+#include <memory>
+#include "DatabaseService.h"
 #include "LoginWindow.h"
 #include "SignUpWindow.h"
 #include "TransactionForm.h"
@@ -11,6 +13,8 @@
 #include "ViewTransactions.h"
 #include "User.h"
 #include "Ledger.h"
+#include "LedgerCache.h"
+#include "TransactionCursor.h"
 
 namespace Ui {
 class MainWindow;
@@ -80,10 +84,26 @@ private slots:
     QVector<QPointF> getDataPointsForGraph();
 
     /**
-     * @brief Reloads the Ledger after a new transaction is added.
+     * @brief Reloads the Ledger and all views from the database, one page at a time.
      */
     void reloadLedger();
 
+    /**
+     * @brief Shows the current user's cached ledger, if any, and otherwise reloads it.
+     */
+    void restoreLedger();
+
+    /**
+     * @brief Applies a newly saved transaction to the Ledger and patches both views.
+     * @param transaction The saved transaction, including its database id.
+     */
+    void onTransactionSaved(const Transaction &transaction);
+
+    /**
+     * @brief Asks for a CSV bank statement and imports it for the current user with a progress dialog.
+     */
+    void importCsv();
+
     /**
      * @brief Handles navigation combo box changes.
      * @param text The current text of the navigation combo box.
@@ -110,7 +130,7 @@ private slots:
 
 private:
     Ui::MainWindow *ui; ///< Pointer to the UI components of MainWindow.
-    QSqlDatabase m_db; ///< Database connection reference.
+    DatabaseService *dbService; ///< Runs all database work on a worker thread.
     User currentUser; ///< The currently logged-in user.
     LoginWindow *loginWindow; ///< Pointer to the LoginWindow.
     SignUpWindow *signUpWindow; ///< Pointer to the SignUpWindow.
@@ -118,7 +138,13 @@ private:
     GraphView *graphView; ///< Pointer to the GraphView.
     Settings *settings; ///< Pointer to the Settings.
     ViewTransactions *viewTransactions; ///< Pointer to the ViewTransactions.
-    Ledger ledger; ///< Ledger object managing financial transactions.
+    std::shared_ptr<Ledger> ledger; ///< Ledger object managing financial transactions; shared read-only with the views.
+    int ledgerGeneration; ///< Incremented by each reload so stale pages can be discarded.
+    bool ledgerLoading; ///< True while pages of the ledger are still being read.
+    TransactionCursor::Position ledgerPosition; ///< Key of the last row loaded into the Ledger.
+    std::unique_ptr<Ledger::Batch> ledgerBatch; ///< Holds the ledger's change notifications while it loads.
+    qint64 ledgerDataVersion; ///< The user's ledger_versions counter before the ledger was loaded; -1 if unknown.
+    LedgerCache ledgerCache; ///< Ledgers of recently logged-out users.
 
     /**
      * @brief Updates the visibility of the navigation combo box based on the current page.
@@ -126,7 +152,73 @@ private:
     void updateNavVisibility();
 
     /**
-     * @brief Updates the user details in the database.
+     * @brief Loads the current user's ledger from their snapshot file.
+     *
+     * Falls back to requestLedgerPage() if there is no valid, current snapshot.
+     *
+     * @param generation The load the snapshot belongs to; stale results are discarded.
+     */
+    void requestLedgerSnapshot(int generation);
+
+    /**
+     * @brief Checks a cached ledger against the database and adds the rows newer than it.
+     *
+     * Falls back to reloadLedger() if the user's rows were updated or deleted since.
+     *
+     * @param generation The load the check belongs to; stale results are discarded.
+     * @param dataVersion The ledger_versions counter the cached ledger reflects.
+     * @param maxId The highest transaction id in the cached ledger.
+     */
+    void requestLedgerValidation(int generation, qint64 dataVersion, int maxId);
+
+    /**
+     * @brief Moves a completely loaded Ledger into the cache and gives the views an empty one.
+     */
+    void stashLedger();
+
+    /**
+     * @brief Writes the Ledger to the current user's snapshot file on the database thread.
+     *
+     * The file is stamped with ledgerDataVersion; nothing is written if it is unknown.
+     */
+    void writeLedgerSnapshot();
+
+    /**
+     * @brief Reads the next page of the current user's transactions into the Ledger.
+     *
+     * Each page is a separate database job, so saves and other queries interleave with a
+     * long load. The next page is requested from the completion callback until the end.
+     *
+     * @param generation The load the page belongs to; stale pages are discarded.
+     */
+    void requestLedgerPage(int generation);
+
+    /**
+     * @brief Adds the rows a CSV import inserted to the completely loaded Ledger.
+     *
+     * Reads the user's rows with ids above the ledger's instead of reloading it. Imports
+     * only insert, so the ledger_versions counter the ledger reflects is unchanged. Falls
+     * back to reloadLedger() if the rows cannot be read.
+     *
+     * @param generation The load the ledger belongs to; stale results are discarded.
+     * @param maxId The highest transaction id in the Ledger.
+     */
+    void requestImportedRows(int generation, int maxId);
+
+    /**
+     * @brief Reads the current user's daily_totals rows and hands them to the GraphView.
+     *
+     * Requested once the ledger has finished loading; saves that complete before the rows
+     * arrive are already included in them, later ones are added by the GraphView itself.
+     *
+     * @param generation The load the rows belong to; stale results are discarded.
+     */
+    void requestDailyTotals(int generation);
+
+    /**
+     * @brief Updates the user details in the database. Runs on the database thread.
+     * @param db The database connection.
+     * @param userId The user to update.
      * @param firstName Updated first name.
      * @param lastName Updated last name.
      * @param position Updated position.
@@ -134,8 +226,9 @@ private:
      * @param password Updated password.
      * @return true if updated successfully, false otherwise.
      */
-    bool updateUserInDatabase(const QString &firstName, const QString &lastName, const QString &position,
-                              const QString &username, const QString &password);
+    static bool updateUserInDatabase(QSqlDatabase &db, int userId,
+                                     const QString &firstName, const QString &lastName, const QString &position,
+                                     const QString &username, const QString &password);
 
     /**
      * @brief Populates the Settings UI with the current user's data.
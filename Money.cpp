@@ -0,0 +1,124 @@
+#include "Money.h"
+#include "AmountKernels.h"
+#include <cmath>
+
+Money Money::fromDouble(double value)
+{
+    return Money(static_cast<qint64>(std::llround(value * 100.0)));
+}
+
+Money Money::parse(const QString &text, bool *ok)
+{
+    if (ok) {
+        *ok = false;
+    }
+
+    QString s = text.trimmed();
+    bool negative = false;
+    if (s.startsWith('(') && s.endsWith(')')) {
+        negative = true;
+        s = s.mid(1, s.size() - 2).trimmed();
+    }
+    if (s.startsWith('-') || s.startsWith('+')) {
+        negative = negative != (s.at(0) == '-');
+        s.remove(0, 1);
+    }
+    if (s.startsWith('$')) {
+        s.remove(0, 1);
+    }
+    s.remove(',');
+
+    qint64 whole = 0;
+    qint64 fraction = 0;
+    int fractionDigits = 0;
+    bool roundUp = false;
+    bool seenDigit = false;
+    bool seenPoint = false;
+
+    for (const QChar c : s) {
+        if (c == '.' && !seenPoint) {
+            seenPoint = true;
+            continue;
+        }
+        if (!c.isDigit()) {
+            return Money();
+        }
+        const int digit = c.digitValue();
+        seenDigit = true;
+        if (!seenPoint) {
+            // Reject amounts that would not fit in 64-bit cents
+            if (whole > (Q_INT64_C(9223372036854775807) / 100 - digit) / 10) {
+                return Money();
+            }
+            whole = whole * 10 + digit;
+        } else if (fractionDigits < 2) {
+            fraction = fraction * 10 + digit;
+            ++fractionDigits;
+        } else if (fractionDigits == 2) {
+            roundUp = digit >= 5;
+            ++fractionDigits;
+        }
+    }
+    if (!seenDigit) {
+        return Money();
+    }
+
+    if (fractionDigits == 1) {
+        fraction *= 10;
+    }
+    // The digit check bounds whole * 100, but the cents added to it can still overflow
+    const qint64 extraCents = fraction + (roundUp ? 1 : 0);
+    if (whole * 100 > Q_INT64_C(9223372036854775807) - extraCents) {
+        return Money();
+    }
+    qint64 cents = whole * 100 + extraCents;
+
+    if (ok) {
+        *ok = true;
+    }
+    return Money(negative ? -cents : cents);
+}
+
+double Money::toDouble() const
+{
+    return static_cast<double>(cents) / 100.0;
+}
+
+QString Money::toString() const
+{
+    return QString::fromStdString(toStdString());
+}
+
+std::string Money::toStdString() const
+{
+    // Work on the magnitude as unsigned so the most negative value still formats
+    const bool negative = cents < 0;
+    const quint64 magnitude = negative ? 0 - static_cast<quint64>(cents) : static_cast<quint64>(cents);
+    const quint64 fraction = magnitude % 100;
+
+    std::string text = negative ? "-" : "";
+    text += std::to_string(magnitude / 100);
+    text += '.';
+    text += static_cast<char>('0' + fraction / 10);
+    text += static_cast<char>('0' + fraction % 10);
+    return text;
+}
+
+Money Money::percentage(double percent) const
+{
+    // Hundredths of a percent keep the product in integers: cents * basisPoints / 10000
+    const qint64 basisPoints = static_cast<qint64>(std::llround(percent * 100.0));
+    const qint64 product = cents * basisPoints;
+    const qint64 half = product < 0 ? -5000 : 5000;
+    return Money((product + half) / 10000);
+}
+
+Money Money::sum(const Money *values, std::size_t count)
+{
+    return AmountKernels::sum(values, count);
+}
+
+Money Money::signedSum(const Money *values, const quint8 *credit, std::size_t count)
+{
+    return AmountKernels::signedSum(values, credit, count);
+}
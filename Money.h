@@ -0,0 +1,127 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <QString>
+#include <QtGlobal>
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief The Money class is an exact monetary amount stored as a 64-bit count of cents.
+ *
+ * Additions and subtractions are integer operations, so balances accumulated over any number
+ * of transactions never drift the way repeated double arithmetic does. Conversion to double
+ * only happens at the edges that need it, such as chart coordinates.
+ */
+class Money {
+public:
+    /**
+     * @brief Constructs a zero amount.
+     */
+    constexpr Money() : cents(0) {}
+
+    /**
+     * @brief Constructs an amount from a count of cents.
+     * @param cents The amount in cents.
+     * @return The amount.
+     */
+    static constexpr Money fromCents(qint64 cents) { return Money(cents); }
+
+    /**
+     * @brief Constructs an amount from a value in dollars, rounding to the nearest cent.
+     * @param value The amount in dollars.
+     * @return The amount.
+     */
+    static Money fromDouble(double value);
+
+    /**
+     * @brief Parses an amount such as "12", "-3.5", "$1,234.56" or "(12.00)".
+     *
+     * A leading '$', thousands separators and surrounding whitespace are ignored, and
+     * parentheses denote a negative amount. Digits beyond the cents are rounded half away
+     * from zero.
+     *
+     * @param text The text to parse.
+     * @param ok Set to true if the text was a valid amount, false otherwise; may be null.
+     * @return The parsed amount, or zero if the text was invalid.
+     */
+    static Money parse(const QString &text, bool *ok = nullptr);
+
+    /**
+     * @brief Retrieves the amount in cents.
+     * @return The amount in cents.
+     */
+    constexpr qint64 toCents() const { return cents; }
+
+    /**
+     * @brief Retrieves the amount in dollars, for display scales and charts.
+     * @return The amount as a double.
+     */
+    double toDouble() const;
+
+    /**
+     * @brief Formats the amount with two decimals, e.g. "-1234.50".
+     * @return The formatted amount.
+     */
+    QString toString() const;
+
+    /**
+     * @brief Formats the amount with two decimals, e.g. "-1234.50".
+     * @return The formatted amount.
+     */
+    std::string toStdString() const;
+
+    /**
+     * @brief Computes a percentage of the amount, rounded half away from zero to the nearest cent.
+     * @param percent The percentage; resolved to hundredths of a percent.
+     * @return The portion of the amount.
+     */
+    Money percentage(double percent) const;
+
+    /**
+     * @brief Sums a contiguous array of amounts exactly.
+     *
+     * Runs the widest AmountKernels implementation the processor supports; integer addition
+     * is associative, so the result does not depend on the order.
+     *
+     * @param values The amounts.
+     * @param count The number of amounts.
+     * @return The total.
+     */
+    static Money sum(const Money *values, std::size_t count);
+
+    /**
+     * @brief Sums amounts with a sign chosen per element: added where credit is non-zero, subtracted otherwise.
+     * @param values The amounts.
+     * @param credit One flag per amount, 1 for income and 0 for expenses.
+     * @param count The number of amounts.
+     * @return The net total.
+     */
+    static Money signedSum(const Money *values, const quint8 *credit, std::size_t count);
+
+    // Arithmetic and comparisons work on the cent count directly
+
+    constexpr bool isZero() const { return cents == 0; }
+    constexpr bool isNegative() const { return cents < 0; }
+    constexpr bool isPositive() const { return cents > 0; }
+
+    constexpr Money operator-() const { return Money(-cents); }
+    constexpr Money operator+(Money other) const { return Money(cents + other.cents); }
+    constexpr Money operator-(Money other) const { return Money(cents - other.cents); }
+    Money &operator+=(Money other) { cents += other.cents; return *this; }
+    Money &operator-=(Money other) { cents -= other.cents; return *this; }
+
+    constexpr bool operator==(Money other) const { return cents == other.cents; }
+    constexpr bool operator!=(Money other) const { return cents != other.cents; }
+    constexpr bool operator<(Money other) const { return cents < other.cents; }
+    constexpr bool operator<=(Money other) const { return cents <= other.cents; }
+    constexpr bool operator>(Money other) const { return cents > other.cents; }
+    constexpr bool operator>=(Money other) const { return cents >= other.cents; }
+
+private:
+    constexpr explicit Money(qint64 cents) : cents(cents) {}
+
+    qint64 cents; ///< The amount in cents.
+};
+
+#endif // MONEY_H
@@ -2,16 +2,39 @@ QT += core gui widgets charts sql
 
 CONFIG += c++17
 
+# QThreadPool::start() with a lambda needs Qt 5.15, and Qt::endl needs Qt 5.14
+lessThan(QT_MAJOR_VERSION, 5): error("Qt 5.15 or later is required; this is Qt $$[QT_VERSION].")
+equals(QT_MAJOR_VERSION, 5):lessThan(QT_MINOR_VERSION, 15): error("Qt 5.15 or later is required; this is Qt $$[QT_VERSION].")
+
 TARGET = PersonalFinanceManager
 
 SOURCES += \
+    AmountKernels.cpp \
+    BalanceIndex.cpp \
+    Categories.cpp \
+    CsvImporter.cpp \
+    DailyTotals.cpp \
+    Database.cpp \
+    DatabaseService.cpp \
+    DateUtil.cpp \
     GraphView.cpp \
     Ledger.cpp \
+    LedgerCache.cpp \
+    LedgerQuery.cpp \
+    LedgerReport.cpp \
+    LedgerSnapshot.cpp \
     LoginWindow.cpp \
+    Money.cpp \
     PasswordManager.cpp \
+    RoaringBitmap.cpp \
+    SchemaMigrator.cpp \
     SignUpWindow.cpp \
+    StatementCache.cpp \
+    StringInterner.cpp \
     Transaction.cpp \
+    TransactionCursor.cpp \
     TransactionForm.cpp \
+    TrigramIndex.cpp \
     ViewTransactions.cpp \
     main.cpp \
     MainWindow.cpp \
@@ -20,14 +43,33 @@ SOURCES += \
     userlogin.cpp
 
 HEADERS += \
+    AmountKernels.h \
+    BalanceIndex.h \
+    Categories.h \
+    CsvImporter.h \
+    DailyTotals.h \
+    Database.h \
+    DatabaseService.h \
+    DateUtil.h \
     GraphView.h \
     Ledger.h \
+    LedgerCache.h \
+    LedgerQuery.h \
+    LedgerReport.h \
+    LedgerSnapshot.h \
     LoginWindow.h \
     MainWindow.h \
+    Money.h \
     PasswordManager.h \
+    RoaringBitmap.h \
+    SchemaMigrator.h \
     SignUpWindow.h \
+    StatementCache.h \
+    StringInterner.h \
     Transaction.h \
+    TransactionCursor.h \
     TransactionForm.h \
+    TrigramIndex.h \
     User.h \
     ViewTransactions.h \
     settings.h \
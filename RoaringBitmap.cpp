@@ -0,0 +1,344 @@
+#include "RoaringBitmap.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+const quint32 MaxArraySize = 4096; // Above this an array container takes more room than a bitmap
+const quint32 MinBitmapSize = MaxArraySize / 2; // Below this a bitmap container emptied by remove() becomes an array
+const size_t WordCount = 1024;      // 65536 bits
+
+inline quint16 highBits(quint32 value)
+{
+    return static_cast<quint16>(value >> 16);
+}
+
+inline quint16 lowBits(quint32 value)
+{
+    return static_cast<quint16>(value & 0xFFFF);
+}
+
+inline bool testBit(const std::vector<quint64> &words, quint16 bit)
+{
+    return (words[bit >> 6] >> (bit & 63)) & 1;
+}
+
+} // namespace
+
+void RoaringBitmap::Container::toBitmap()
+{
+    words.assign(WordCount, 0);
+    for (quint16 value : values) {
+        words[value >> 6] |= quint64(1) << (value & 63);
+    }
+    values.clear();
+    values.shrink_to_fit();
+}
+
+void RoaringBitmap::Container::toArray()
+{
+    values.clear();
+    values.reserve(cardinality);
+    for (size_t i = 0; i < words.size(); ++i) {
+        for (quint64 word = words[i]; word != 0; word &= word - 1) {
+            values.push_back(static_cast<quint16>(i * 64 + qCountTrailingZeroBits(word)));
+        }
+    }
+    words.clear();
+    words.shrink_to_fit();
+}
+
+void RoaringBitmap::add(quint32 value)
+{
+    const quint16 key = highBits(value);
+    const quint16 low = lowBits(value);
+    auto it = (!containers.empty() && containers.back().key == key) ? containers.end() - 1 : lowerBound(key);
+    if (it == containers.end() || it->key != key) {
+        it = containers.insert(it, Container());
+        it->key = key;
+    }
+
+    if (it->isBitmap()) {
+        quint64 &word = it->words[low >> 6];
+        const quint64 mask = quint64(1) << (low & 63);
+        if (!(word & mask)) {
+            word |= mask;
+            ++it->cardinality;
+        }
+        return;
+    }
+
+    std::vector<quint16> &values = it->values;
+    if (values.empty() || values.back() < low) {
+        values.push_back(low);
+    } else {
+        auto pos = std::lower_bound(values.begin(), values.end(), low);
+        if (*pos == low) {
+            return;
+        }
+        values.insert(pos, low);
+    }
+    if (++it->cardinality > MaxArraySize) {
+        it->toBitmap();
+    }
+}
+
+void RoaringBitmap::remove(quint32 value)
+{
+    const quint16 low = lowBits(value);
+    auto it = lowerBound(highBits(value));
+    if (it == containers.end() || it->key != highBits(value)) {
+        return;
+    }
+
+    if (it->isBitmap()) {
+        quint64 &word = it->words[low >> 6];
+        const quint64 mask = quint64(1) << (low & 63);
+        if (!(word & mask)) {
+            return;
+        }
+        word &= ~mask;
+        // Converting back only well below MaxArraySize keeps a container that hovers around
+        // it from rebuilding 8 KiB on every add and remove
+        if (--it->cardinality < MinBitmapSize) {
+            it->toArray();
+        }
+    } else {
+        auto pos = std::lower_bound(it->values.begin(), it->values.end(), low);
+        if (pos == it->values.end() || *pos != low) {
+            return;
+        }
+        it->values.erase(pos);
+        --it->cardinality;
+    }
+
+    if (it->cardinality == 0) {
+        containers.erase(it);
+    }
+}
+
+bool RoaringBitmap::contains(quint32 value) const
+{
+    auto it = lowerBound(highBits(value));
+    if (it == containers.end() || it->key != highBits(value)) {
+        return false;
+    }
+    if (it->isBitmap()) {
+        return testBit(it->words, lowBits(value));
+    }
+    return std::binary_search(it->values.begin(), it->values.end(), lowBits(value));
+}
+
+size_t RoaringBitmap::cardinality() const
+{
+    size_t count = 0;
+    for (const Container &container : containers) {
+        count += container.cardinality;
+    }
+    return count;
+}
+
+bool RoaringBitmap::isEmpty() const
+{
+    return containers.empty();
+}
+
+void RoaringBitmap::clear()
+{
+    containers.clear();
+}
+
+size_t RoaringBitmap::memoryUsage() const
+{
+    size_t bytes = containers.capacity() * sizeof(Container);
+    for (const Container &container : containers) {
+        bytes += container.values.capacity() * sizeof(quint16) + container.words.capacity() * sizeof(quint64);
+    }
+    return bytes;
+}
+
+RoaringBitmap &RoaringBitmap::operator&=(const RoaringBitmap &other)
+{
+    size_t kept = 0;
+    auto theirs = other.containers.begin();
+    for (size_t i = 0; i < containers.size() && theirs != other.containers.end(); ++i) {
+        Container &ours = containers[i];
+        while (theirs != other.containers.end() && theirs->key < ours.key) {
+            ++theirs;
+        }
+        if (theirs == other.containers.end() || theirs->key != ours.key) {
+            continue;
+        }
+        intersect(ours, *theirs);
+        if (ours.cardinality > 0) {
+            if (kept != i) {
+                containers[kept] = std::move(ours);
+            }
+            ++kept;
+        }
+    }
+    containers.resize(kept);
+    return *this;
+}
+
+RoaringBitmap &RoaringBitmap::operator|=(const RoaringBitmap &other)
+{
+    std::vector<Container> merged;
+    merged.reserve(containers.size() + other.containers.size());
+    auto ours = containers.begin();
+    auto theirs = other.containers.begin();
+    while (ours != containers.end() || theirs != other.containers.end()) {
+        if (theirs == other.containers.end() || (ours != containers.end() && ours->key < theirs->key)) {
+            merged.push_back(std::move(*ours++));
+        } else if (ours == containers.end() || theirs->key < ours->key) {
+            merged.push_back(*theirs++);
+        } else {
+            unite(*ours, *theirs++);
+            merged.push_back(std::move(*ours++));
+        }
+    }
+    containers.swap(merged);
+    return *this;
+}
+
+std::vector<quint32> RoaringBitmap::toVector() const
+{
+    std::vector<quint32> result;
+    result.reserve(cardinality());
+    for (const Container &container : containers) {
+        const quint32 base = quint32(container.key) << 16;
+        if (container.isBitmap()) {
+            for (size_t i = 0; i < container.words.size(); ++i) {
+                for (quint64 word = container.words[i]; word != 0; word &= word - 1) {
+                    result.push_back(base + static_cast<quint32>(i * 64 + qCountTrailingZeroBits(word)));
+                }
+            }
+        } else {
+            for (quint16 value : container.values) {
+                result.push_back(base + value);
+            }
+        }
+    }
+    return result;
+}
+
+std::vector<quint64> RoaringBitmap::toWords(quint32 limit) const
+{
+    std::vector<quint64> result((static_cast<size_t>(limit) + 63) / 64, 0);
+    for (const Container &container : containers) {
+        // Each container covers WordCount whole words, so bitmap containers are copied as is
+        const size_t firstWord = static_cast<size_t>(container.key) * WordCount;
+        if (firstWord >= result.size()) {
+            break;
+        }
+        if (container.isBitmap()) {
+            const size_t count = std::min(WordCount, result.size() - firstWord);
+            std::copy(container.words.begin(), container.words.begin() + static_cast<std::ptrdiff_t>(count),
+                      result.begin() + static_cast<std::ptrdiff_t>(firstWord));
+        } else {
+            for (quint16 value : container.values) {
+                const size_t word = firstWord + (value >> 6);
+                if (word < result.size()) {
+                    result[word] |= quint64(1) << (value & 63);
+                }
+            }
+        }
+    }
+    // Bits past the limit in the last word may be set; callers only test values below it
+    return result;
+}
+
+std::vector<RoaringBitmap::Container>::iterator RoaringBitmap::lowerBound(quint16 key)
+{
+    return std::lower_bound(containers.begin(), containers.end(), key,
+                            [](const Container &container, quint16 k) { return container.key < k; });
+}
+
+std::vector<RoaringBitmap::Container>::const_iterator RoaringBitmap::lowerBound(quint16 key) const
+{
+    return std::lower_bound(containers.begin(), containers.end(), key,
+                            [](const Container &container, quint16 k) { return container.key < k; });
+}
+
+void RoaringBitmap::intersect(Container &a, const Container &b)
+{
+    if (a.isBitmap() && b.isBitmap()) {
+        quint32 count = 0;
+        for (size_t i = 0; i < WordCount; ++i) {
+            a.words[i] &= b.words[i];
+            count += qPopulationCount(a.words[i]);
+        }
+        a.cardinality = count;
+        if (count <= MaxArraySize) {
+            a.toArray();
+        }
+    } else if (a.isBitmap()) {
+        // The result is no larger than b's array, so it becomes an array
+        std::vector<quint16> values;
+        values.reserve(b.values.size());
+        for (quint16 value : b.values) {
+            if (testBit(a.words, value)) {
+                values.push_back(value);
+            }
+        }
+        a.words.clear();
+        a.words.shrink_to_fit();
+        a.values.swap(values);
+        a.cardinality = static_cast<quint32>(a.values.size());
+    } else if (b.isBitmap()) {
+        auto end = std::remove_if(a.values.begin(), a.values.end(),
+                                  [&b](quint16 value) { return !testBit(b.words, value); });
+        a.values.erase(end, a.values.end());
+        a.cardinality = static_cast<quint32>(a.values.size());
+    } else {
+        // Merge in place; the write index never passes the read index
+        size_t kept = 0;
+        auto theirs = b.values.begin();
+        for (size_t i = 0; i < a.values.size() && theirs != b.values.end(); ++i) {
+            theirs = std::lower_bound(theirs, b.values.end(), a.values[i]);
+            if (theirs != b.values.end() && *theirs == a.values[i]) {
+                a.values[kept++] = a.values[i];
+            }
+        }
+        a.values.resize(kept);
+        a.cardinality = static_cast<quint32>(kept);
+    }
+}
+
+void RoaringBitmap::unite(Container &a, const Container &b)
+{
+    if (!a.isBitmap() && !b.isBitmap()) {
+        std::vector<quint16> values;
+        values.reserve(a.values.size() + b.values.size());
+        std::set_union(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(),
+                       std::back_inserter(values));
+        a.values.swap(values);
+        a.cardinality = static_cast<quint32>(a.values.size());
+        if (a.cardinality > MaxArraySize) {
+            a.toBitmap();
+        }
+        return;
+    }
+
+    if (!a.isBitmap()) {
+        a.toBitmap();
+    }
+    if (b.isBitmap()) {
+        quint32 count = 0;
+        for (size_t i = 0; i < WordCount; ++i) {
+            a.words[i] |= b.words[i];
+            count += qPopulationCount(a.words[i]);
+        }
+        a.cardinality = count;
+    } else {
+        quint32 count = a.cardinality;
+        for (quint16 value : b.values) {
+            quint64 &word = a.words[value >> 6];
+            const quint64 mask = quint64(1) << (value & 63);
+            count += (word & mask) ? 0 : 1;
+            word |= mask;
+        }
+        a.cardinality = count;
+    }
+}
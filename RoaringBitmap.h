@@ -0,0 +1,132 @@
+#ifndef ROARINGBITMAP_H
+#define ROARINGBITMAP_H
+
+#include <QtGlobal>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief The RoaringBitmap class is a compressed set of 32-bit integers.
+ *
+ * Values are split on their upper 16 bits into containers of at most 65536 values. A
+ * container holding up to 4096 values is a sorted array of their lower 16 bits; a fuller one
+ * is a plain 65536-bit bitmap. Sparse sets therefore cost two bytes per value and dense ones
+ * one bit per possible value, and intersections and unions work container by container,
+ * skipping every key the other set does not have. A bitmap that values are removed from
+ * stays a bitmap until it is half that full, so it does not flip back and forth.
+ *
+ * Adding values in ascending order, as a ledger does with its positions, appends to the
+ * last container without shifting anything.
+ */
+class RoaringBitmap {
+public:
+    /**
+     * @brief Adds a value.
+     * @param value The value; adding one already present does nothing.
+     */
+    void add(quint32 value);
+
+    /**
+     * @brief Removes a value.
+     * @param value The value; removing one not present does nothing.
+     */
+    void remove(quint32 value);
+
+    /**
+     * @brief Checks whether a value is present.
+     * @param value The value.
+     * @return true if the value is in the set, false otherwise.
+     */
+    bool contains(quint32 value) const;
+
+    /**
+     * @brief Counts the values in the set.
+     * @return The number of values.
+     */
+    size_t cardinality() const;
+
+    /**
+     * @brief Checks whether the set is empty.
+     * @return true if there are no values, false otherwise.
+     */
+    bool isEmpty() const;
+
+    /**
+     * @brief Removes all values.
+     */
+    void clear();
+
+    /**
+     * @brief Estimates the heap memory held by the set.
+     * @return The size in bytes.
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * @brief Keeps only the values also present in another set.
+     * @param other The other set.
+     * @return This set.
+     */
+    RoaringBitmap &operator&=(const RoaringBitmap &other);
+
+    /**
+     * @brief Adds every value of another set.
+     * @param other The other set.
+     * @return This set.
+     */
+    RoaringBitmap &operator|=(const RoaringBitmap &other);
+
+    /**
+     * @brief Lists the values.
+     * @return The values in ascending order.
+     */
+    std::vector<quint32> toVector() const;
+
+    /**
+     * @brief Expands the values below a limit into a plain bitmap.
+     * @param limit One past the largest value of interest.
+     * @return One bit per value below limit, 64 to a word; value v is bit v % 64 of word v / 64.
+     */
+    std::vector<quint64> toWords(quint32 limit) const;
+
+private:
+    /**
+     * @brief The values sharing one upper 16-bit key.
+     */
+    struct Container {
+        quint16 key = 0;              ///< Upper 16 bits of every value.
+        quint32 cardinality = 0;      ///< Number of values held.
+        std::vector<quint16> values;  ///< Sorted lower bits, while this is an array container.
+        std::vector<quint64> words;   ///< 1024 words of bits, while this is a bitmap container.
+
+        bool isBitmap() const { return !words.empty(); }
+        void toBitmap();
+        void toArray();
+    };
+
+    /**
+     * @brief Finds the container of a key.
+     * @param key The upper 16 bits.
+     * @return The first container whose key is not less than key.
+     */
+    std::vector<Container>::iterator lowerBound(quint16 key);
+    std::vector<Container>::const_iterator lowerBound(quint16 key) const;
+
+    /**
+     * @brief Intersects two containers with the same key.
+     * @param a The container updated in place.
+     * @param b The other container.
+     */
+    static void intersect(Container &a, const Container &b);
+
+    /**
+     * @brief Unites two containers with the same key.
+     * @param a The container updated in place.
+     * @param b The other container.
+     */
+    static void unite(Container &a, const Container &b);
+
+    std::vector<Container> containers; ///< Non-empty containers, sorted by key.
+};
+
+#endif // ROARINGBITMAP_H
@@ -0,0 +1,297 @@
+#include "SchemaMigrator.h"
+#include "DailyTotals.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QVariant>
+#include <QDebug>
+
+// Runs one statement, describing the failure in error.
+static bool execStatement(QSqlDatabase &db, const QString &sql, QString &error)
+{
+    QSqlQuery query(db);
+    if (!query.exec(sql)) {
+        error = query.lastError().text() + " (" + sql.left(80) + ")";
+        return false;
+    }
+    return true;
+}
+
+// Version 1: the tables as originally shipped, with text dates and REAL amounts.
+static bool createBaseTables(QSqlDatabase &db, QString &error)
+{
+    return execStatement(db, "CREATE TABLE IF NOT EXISTS User ("
+                             "userID INTEGER PRIMARY KEY AUTOINCREMENT,"
+                             "firstname TEXT NOT NULL,"
+                             "lastname TEXT NOT NULL,"
+                             "position TEXT NOT NULL)", error)
+        && execStatement(db, "CREATE TABLE IF NOT EXISTS UserLogin ("
+                             "loginID INTEGER PRIMARY KEY AUTOINCREMENT,"
+                             "username TEXT UNIQUE NOT NULL,"
+                             "password TEXT NOT NULL,"
+                             "accessLevel INTEGER NOT NULL,"
+                             "userID INTEGER NOT NULL,"
+                             "FOREIGN KEY(userID) REFERENCES User(userID))", error)
+        && execStatement(db, "CREATE TABLE IF NOT EXISTS transactions ("
+                             "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                             "userId INTEGER NOT NULL, "
+                             "date TEXT NOT NULL, "
+                             "category TEXT NOT NULL, "
+                             "subcategory TEXT, "
+                             "amount REAL NOT NULL, "
+                             "type TEXT NOT NULL, "
+                             "taxWithheld INTEGER NOT NULL DEFAULT 0, "
+                             "taxAmount REAL NOT NULL DEFAULT 0.0, "
+                             "FOREIGN KEY(userId) REFERENCES User(userID))", error);
+}
+
+// Version 2: "yyyy-MM-dd" text dates become day numbers (days since 1970-01-01).
+static bool convertDatesToDayNumbers(QSqlDatabase &db, QString &error)
+{
+    if (!SchemaMigrator::hasColumn(db, "transactions", "date")) {
+        return true;
+    }
+
+    QSqlQuery query(db);
+    if (query.exec("SELECT COUNT(*) FROM transactions WHERE julianday(date) IS NULL") && query.next()) {
+        const int invalid = query.value(0).toInt();
+        if (invalid > 0) {
+            qWarning() << "Migration:" << invalid << "transactions have unparseable dates and are set to 1970-01-01";
+        }
+    }
+    query.finish();
+
+    // Amounts are carried over unchanged, whichever representation they are in at this point
+    const bool realAmounts = SchemaMigrator::hasColumn(db, "transactions", "amount");
+    const QString amountColumn = realAmounts ? "amount REAL NOT NULL, " : "amountCents INTEGER NOT NULL, ";
+    const QString amountName = realAmounts ? "amount" : "amountCents";
+
+    // julianday() of a plain date is N.5; subtracting the epoch's 2440587.5 leaves whole days
+    return SchemaMigrator::rebuildTable(db, "transactions",
+                                        "CREATE TABLE %1 ("
+                                        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                                        "userId INTEGER NOT NULL, "
+                                        "day INTEGER NOT NULL, "
+                                        "category TEXT NOT NULL, "
+                                        "subcategory TEXT, "
+                                        + amountColumn +
+                                        "type TEXT NOT NULL, "
+                                        "taxWithheld INTEGER NOT NULL DEFAULT 0, "
+                                        "taxAmount REAL NOT NULL DEFAULT 0.0, "
+                                        "FOREIGN KEY(userId) REFERENCES User(userID))",
+                                        "id, userId, day, category, subcategory, " + amountName + ", type, taxWithheld, taxAmount",
+                                        "id, userId, COALESCE(CAST(julianday(date) - 2440587.5 AS INTEGER), 0), "
+                                        "category, subcategory, " + amountName + ", type, taxWithheld, taxAmount",
+                                        error);
+}
+
+// Version 3: REAL amounts become integer cents.
+static bool convertAmountsToCents(QSqlDatabase &db, QString &error)
+{
+    if (!SchemaMigrator::hasColumn(db, "transactions", "amount")) {
+        return true;
+    }
+
+    return SchemaMigrator::rebuildTable(db, "transactions",
+                                        "CREATE TABLE %1 ("
+                                        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                                        "userId INTEGER NOT NULL, "
+                                        "day INTEGER NOT NULL, "
+                                        "category TEXT NOT NULL, "
+                                        "subcategory TEXT, "
+                                        "amountCents INTEGER NOT NULL, "
+                                        "type TEXT NOT NULL, "
+                                        "taxWithheld INTEGER NOT NULL DEFAULT 0, "
+                                        "taxAmount REAL NOT NULL DEFAULT 0.0, "
+                                        "FOREIGN KEY(userId) REFERENCES User(userID))",
+                                        "id, userId, day, category, subcategory, amountCents, type, taxWithheld, taxAmount",
+                                        "id, userId, day, category, subcategory, "
+                                        "CAST(ROUND(ROUND(amount, 2) * 100) AS INTEGER), type, taxWithheld, taxAmount",
+                                        error);
+}
+
+// Version 4: indexes for per-user loads and all-user cursor pages, both in (day, id) order.
+static bool createDayIndexes(QSqlDatabase &db, QString &error)
+{
+    return execStatement(db, "DROP INDEX IF EXISTS idx_transactions_user_date", error)
+        && execStatement(db, "DROP INDEX IF EXISTS idx_transactions_date", error)
+        && execStatement(db, "CREATE INDEX IF NOT EXISTS idx_transactions_user_day ON transactions(userId, day)", error)
+        && execStatement(db, "CREATE INDEX IF NOT EXISTS idx_transactions_day ON transactions(day)", error);
+}
+
+// Version 5: daily_totals rollup kept current by triggers, backfilled from existing rows.
+static bool createDailyTotals(QSqlDatabase &db, QString &error)
+{
+    const QString matchOld = "WHERE userId = OLD.userId AND day = OLD.day AND category = OLD.category AND type = OLD.type";
+    const QString addNew = "INSERT INTO daily_totals (userId, day, category, type, netCents, transactionCount) "
+                           "VALUES (NEW.userId, NEW.day, NEW.category, NEW.type, " + DailyTotals::netCentsSql("NEW.") + ", 1) "
+                           "ON CONFLICT (userId, day, category, type) DO UPDATE SET "
+                           "netCents = netCents + excluded.netCents, transactionCount = transactionCount + 1;";
+    const QString removeOld = "UPDATE daily_totals SET netCents = netCents - " + DailyTotals::netCentsSql("OLD.") + ", "
+                              "transactionCount = transactionCount - 1 " + matchOld + "; "
+                              "DELETE FROM daily_totals " + matchOld + " AND transactionCount = 0;";
+
+    if (!execStatement(db, "CREATE TABLE daily_totals ("
+                           "userId INTEGER NOT NULL, "
+                           "day INTEGER NOT NULL, "
+                           "category TEXT NOT NULL, "
+                           "type TEXT NOT NULL, "
+                           "netCents INTEGER NOT NULL, "
+                           "transactionCount INTEGER NOT NULL, "
+                           "PRIMARY KEY (userId, day, category, type)) WITHOUT ROWID", error)
+        || !execStatement(db, "CREATE TRIGGER daily_totals_insert AFTER INSERT ON transactions "
+                              "BEGIN " + addNew + " END", error)
+        || !execStatement(db, "CREATE TRIGGER daily_totals_delete AFTER DELETE ON transactions "
+                              "BEGIN " + removeOld + " END", error)
+        || !execStatement(db, "CREATE TRIGGER daily_totals_update "
+                              "AFTER UPDATE OF userId, day, category, type, amountCents, taxWithheld, taxAmount ON transactions "
+                              "BEGIN " + removeOld + " " + addNew + " END", error)) {
+        return false;
+    }
+    return DailyTotals::rebuild(db, error);
+}
+
+// Version 6: per-user counter of updates and deletes, so caches of a user's rows can tell
+// whether rows they already hold have changed. Inserts are recognised by their newer ids.
+static bool createLedgerVersions(QSqlDatabase &db, QString &error)
+{
+    const QString bump = "INSERT INTO ledger_versions (userId, version) VALUES (%1.userId, 1) "
+                         "ON CONFLICT (userId) DO UPDATE SET version = version + 1;";
+
+    return execStatement(db, "CREATE TABLE ledger_versions ("
+                             "userId INTEGER PRIMARY KEY, "
+                             "version INTEGER NOT NULL)", error)
+        && execStatement(db, "CREATE TRIGGER ledger_versions_delete AFTER DELETE ON transactions "
+                             "BEGIN " + bump.arg("OLD") + " END", error)
+        && execStatement(db, "CREATE TRIGGER ledger_versions_update AFTER UPDATE ON transactions "
+                             "BEGIN " + bump.arg("OLD") + " " + bump.arg("NEW") + " END", error);
+}
+
+// Version 7: the (userId, day) index carries every column, so a user's rows are read from
+// consecutive index pages instead of one table page per row wherever other users' rows lie.
+static bool coverUserDayIndex(QSqlDatabase &db, QString &error)
+{
+    return execStatement(db, "CREATE INDEX IF NOT EXISTS idx_transactions_user_rows ON transactions("
+                             "userId, day, id, category, subcategory, amountCents, type, taxWithheld, taxAmount)", error)
+        && execStatement(db, "DROP INDEX IF EXISTS idx_transactions_user_day", error);
+}
+
+const std::vector<SchemaMigrator::Migration> &SchemaMigrator::migrations()
+{
+    static const std::vector<Migration> steps = {
+        {1, "Create User, UserLogin and transactions tables", createBaseTables},
+        {2, "Store transaction dates as day numbers", convertDatesToDayNumbers},
+        {3, "Store transaction amounts as integer cents", convertAmountsToCents},
+        {4, "Index transactions by (userId, day) and (day)", createDayIndexes},
+        {5, "Add daily_totals rollup maintained by triggers", createDailyTotals},
+        {6, "Add ledger_versions change counters", createLedgerVersions},
+        {7, "Cover per-user loads with a (userId, day) index holding every column", coverUserDayIndex},
+    };
+    return steps;
+}
+
+int SchemaMigrator::latestVersion()
+{
+    return migrations().back().version;
+}
+
+int SchemaMigrator::currentVersion(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA user_version") || !query.next()) {
+        qCritical() << "Failed to read schema version:" << query.lastError().text();
+        return -1;
+    }
+    return query.value(0).toInt();
+}
+
+bool SchemaMigrator::migrate(QSqlDatabase &db, std::vector<StepReport> *report)
+{
+    const int from = currentVersion(db);
+    if (from < 0) {
+        return false;
+    }
+    if (from > latestVersion()) {
+        qCritical() << "Database schema version" << from << "is newer than this application supports ("
+                    << latestVersion() << ")";
+        return false;
+    }
+    if (from == latestVersion()) {
+        return true;
+    }
+
+    if (!db.transaction()) {
+        qCritical() << "Failed to start schema migration:" << db.lastError().text();
+        return false;
+    }
+
+    std::vector<StepReport> applied;
+    QElapsedTimer total;
+    total.start();
+
+    for (const Migration &migration : migrations()) {
+        if (migration.version <= from) {
+            continue;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        QString error;
+        if (!migration.apply(db, error)) {
+            qCritical() << "Schema migration" << migration.version << "(" << migration.description << ") failed:" << error;
+            db.rollback();
+            return false;
+        }
+        applied.push_back({migration.version, migration.description, timer.elapsed()});
+    }
+
+    // user_version lives in the database header and is covered by the transaction
+    QString error;
+    if (!execStatement(db, QString("PRAGMA user_version = %1").arg(latestVersion()), error)) {
+        qCritical() << "Failed to record schema version:" << error;
+        db.rollback();
+        return false;
+    }
+
+    if (!db.commit()) {
+        qCritical() << "Failed to commit schema migration:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+
+    for (const StepReport &step : applied) {
+        qInfo() << "Schema migration" << step.version << "(" << step.description << ") took" << step.elapsedMs << "ms";
+    }
+    qInfo() << "Migrated schema from version" << from << "to" << latestVersion() << "in" << total.elapsed() << "ms";
+
+    if (report) {
+        *report = applied;
+    }
+    return true;
+}
+
+bool SchemaMigrator::hasColumn(QSqlDatabase &db, const QString &table, const QString &column)
+{
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA table_info(" + table + ")")) {
+        return false;
+    }
+    while (query.next()) {
+        if (query.value("name").toString().compare(column, Qt::CaseInsensitive) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SchemaMigrator::rebuildTable(QSqlDatabase &db, const QString &table, const QString &createSql,
+                                  const QString &columns, const QString &selectExpressions, QString &error)
+{
+    const QString rebuilt = table + "_rebuilt";
+    return execStatement(db, "DROP TABLE IF EXISTS " + rebuilt, error)
+        && execStatement(db, createSql.arg(rebuilt), error)
+        && execStatement(db, "INSERT INTO " + rebuilt + " (" + columns + ") "
+                             "SELECT " + selectExpressions + " FROM " + table, error)
+        && execStatement(db, "DROP TABLE " + table, error)
+        && execStatement(db, "ALTER TABLE " + rebuilt + " RENAME TO " + table, error);
+}
@@ -0,0 +1,101 @@
+#ifndef SCHEMAMIGRATOR_H
+#define SCHEMAMIGRATOR_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief The SchemaMigrator class brings a database up to the current schema version.
+ *
+ * The schema version is kept in SQLite's PRAGMA user_version. Each migration step has a
+ * version number and moves the schema from the previous version to its own; steps are
+ * never edited once released, new changes are appended as new steps. migrate() runs every
+ * step above the stored version, in order, inside a single transaction, so a database is
+ * either fully upgraded or left untouched.
+ *
+ * Databases created before versioning report version 0. Their tables may already be in
+ * any intermediate shape, so the early steps check the columns they convert and skip work
+ * that has already been done.
+ */
+class SchemaMigrator {
+public:
+    /**
+     * @brief One ordered schema change.
+     */
+    struct Migration {
+        int version;         ///< The schema version after this step.
+        QString description; ///< Short description for the log.
+        std::function<bool(QSqlDatabase &db, QString &error)> apply; ///< Performs the step; sets error on failure.
+    };
+
+    /**
+     * @brief Timing of one applied step.
+     */
+    struct StepReport {
+        int version;         ///< The version the step migrated to.
+        QString description; ///< The step's description.
+        qint64 elapsedMs;    ///< Wall-clock duration of the step.
+    };
+
+    /**
+     * @brief Retrieves all migration steps in version order.
+     * @return The steps.
+     */
+    static const std::vector<Migration> &migrations();
+
+    /**
+     * @brief Retrieves the version the migrations lead to.
+     * @return The newest schema version.
+     */
+    static int latestVersion();
+
+    /**
+     * @brief Reads the schema version stored in a database.
+     * @param db An open database connection.
+     * @return The stored version, or -1 if it could not be read.
+     */
+    static int currentVersion(QSqlDatabase &db);
+
+    /**
+     * @brief Applies every pending migration step in one transaction.
+     *
+     * Each step's duration is logged. Fails without changes if the database was written
+     * by a newer version of the application.
+     *
+     * @param db An open database connection, not inside a transaction.
+     * @param report Receives the steps that were applied; may be null.
+     * @return true if the database is at latestVersion(), false otherwise.
+     */
+    static bool migrate(QSqlDatabase &db, std::vector<StepReport> *report = nullptr);
+
+    /**
+     * @brief Checks whether a table has a column with the given name.
+     * @param db An open database connection.
+     * @param table The table to inspect.
+     * @param column The column to look for.
+     * @return true if the column exists, false otherwise.
+     */
+    static bool hasColumn(QSqlDatabase &db, const QString &table, const QString &column);
+
+    /**
+     * @brief Rebuilds a table into a new shape with one bulk INSERT ... SELECT.
+     *
+     * SQLite cannot change a column's type in place, so the table is recreated under a
+     * temporary name, filled from the old table, and renamed over it. Indexes on the old
+     * table are dropped with it and must be recreated by the caller.
+     *
+     * @param db An open database connection, inside the migration's transaction.
+     * @param table The table to rebuild.
+     * @param createSql The new table's CREATE TABLE statement with %1 in place of its name.
+     * @param columns Comma-separated columns of the new table to fill.
+     * @param selectExpressions Comma-separated expressions over the old table, one per column.
+     * @param error Receives the failure description.
+     * @return true if the table was rebuilt, false otherwise.
+     */
+    static bool rebuildTable(QSqlDatabase &db, const QString &table, const QString &createSql,
+                             const QString &columns, const QString &selectExpressions, QString &error);
+};
+
+#endif // SCHEMAMIGRATOR_H
@@ -12,6 +12,7 @@
 #include <QTimer>
 #include "user.h"
 #include "userlogin.h"
+#include "StatementCache.h"
 
 static int getAccessLevel(const QString &position) {
     QString pos = position.toLower();
@@ -20,7 +21,7 @@ static int getAccessLevel(const QString &position) {
     return 1; // Default lowest access
 }
 
-SignUpWindow::SignUpWindow(QSqlDatabase db, QWidget *parent) :
+SignUpWindow::SignUpWindow(DatabaseService *db, QWidget *parent) :
     QWidget(parent),
     ui(new Ui::SignUpWindow),
     m_db(db),
@@ -47,7 +48,7 @@ SignUpWindow::SignUpWindow(QSqlDatabase db, QWidget *parent) :
 }
 
 // Default Constructor
-SignUpWindow::SignUpWindow(){}
+SignUpWindow::SignUpWindow() : m_db(nullptr) {}
 
 SignUpWindow::~SignUpWindow()
 {
@@ -120,46 +121,70 @@ void SignUpWindow::on_signUpPushButton_clicked()
     // Create a new User object
     User newUser(0, firstname, lastname, position);
 
-    // Insert the new user into the User table
-    QSqlQuery query(m_db);
-    if (!query.prepare("INSERT INTO User (firstname, lastname, position) VALUES (?, ?, ?)")) {
-        QMessageBox::critical(this, "Error", "Failed to prepare user insert: " + query.lastError().text());
-        return;
-    }
-    query.addBindValue(newUser.getFirstName());
-    query.addBindValue(newUser.getLastName());
-    query.addBindValue(newUser.getPosition());
+    // Both inserts run in one database transaction on the worker thread so a rejected
+    // username does not leave an orphaned User row behind.
+    ui->signUpPushButton->setEnabled(false);
+    m_db->submit<QString>(this, [newUser, username, hashedPassword](QSqlDatabase &db) mutable -> QString {
+        const bool ownsTransaction = db.transaction();
+
+        auto fail = [&db, ownsTransaction](const QString &message) {
+            if (ownsTransaction) {
+                db.rollback();
+            }
+            return message;
+        };
+
+        // Insert the new user into the User table
+        StatementCache &cache = StatementCache::forDatabase(db);
+        bool prepared = false;
+        QSqlQuery &query = cache.prepare("INSERT INTO User (firstname, lastname, position) VALUES (?, ?, ?)", &prepared);
+        if (!prepared) {
+            return fail("Failed to prepare user insert: " + query.lastError().text());
+        }
+        query.addBindValue(newUser.getFirstName());
+        query.addBindValue(newUser.getLastName());
+        query.addBindValue(newUser.getPosition());
 
-    if (!query.exec()) {
-        QMessageBox::critical(this, "Error", "Failed to insert user: " + query.lastError().text());
-        return;
-    }
+        if (!cache.exec(query)) {
+            return fail("Failed to insert user: " + query.lastError().text());
+        }
 
-    int userId = query.lastInsertId().toInt();
-    newUser.setUserId(userId);
-    int accessLevel = getAccessLevel(newUser.getPosition());
+        int userId = query.lastInsertId().toInt();
+        newUser.setUserId(userId);
+        int accessLevel = getAccessLevel(newUser.getPosition());
 
-    // Create a new UserLogin object
-    UserLogin newUserLogin(0, username, hashedPassword, accessLevel, newUser.getUserId());
+        // Create a new UserLogin object
+        UserLogin newUserLogin(0, username, hashedPassword, accessLevel, newUser.getUserId());
 
-    // Insert the new user login into the UserLogin table
-    QSqlQuery query2(m_db);
-    if (!query2.prepare("INSERT INTO UserLogin (username, password, accessLevel, userID) VALUES (?, ?, ?, ?)")) {
-        QMessageBox::critical(this, "Error", "Failed to prepare login insert: " + query2.lastError().text());
-        return;
-    }
-    query2.addBindValue(newUserLogin.getUsername());
-    query2.addBindValue(newUserLogin.getPassword());
-    query2.addBindValue(newUserLogin.getAccessLevel());
-    query2.addBindValue(newUserLogin.getUserId());
+        // Insert the new user login into the UserLogin table
+        QSqlQuery &query2 = cache.prepare("INSERT INTO UserLogin (username, password, accessLevel, userID) VALUES (?, ?, ?, ?)", &prepared);
+        if (!prepared) {
+            return fail("Failed to prepare login insert: " + query2.lastError().text());
+        }
+        query2.addBindValue(newUserLogin.getUsername());
+        query2.addBindValue(newUserLogin.getPassword());
+        query2.addBindValue(newUserLogin.getAccessLevel());
+        query2.addBindValue(newUserLogin.getUserId());
 
-    if (!query2.exec()) {
-        QMessageBox::warning(this, "Error", "Username already exists. " + query2.lastError().text());
-        return;
-    }
+        if (!cache.exec(query2)) {
+            return fail("Username already exists. " + query2.lastError().text());
+        }
+
+        if (ownsTransaction && !db.commit()) {
+            return fail("Failed to save registration: " + db.lastError().text());
+        }
+        return QString();
+    }, [this](QString error) {
+        ui->signUpPushButton->setEnabled(true);
+
+        if (!error.isEmpty()) {
+            QMessageBox::warning(this, "Error", error);
+            return;
+        }
 
-    QMessageBox::information(this, "Success", "User registered successfully. Please log in.");
-    emit showLogin();
+        QMessageBox::information(this, "Success", "User registered successfully. Please log in.");
+        emit showLogin();
+    });
 }
 
 bool SignUpWindow::eventFilter(QObject *obj, QEvent *event)
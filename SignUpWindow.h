@@ -2,8 +2,8 @@
 #define SIGNUPWINDOW_H
 
 #include <QWidget>
-#include <QSqlDatabase>
 #include "PasswordManager.h"
+#include "DatabaseService.h"
 
 namespace Ui {
 class SignUpWindow;
@@ -18,11 +18,11 @@ class SignUpWindow : public QWidget
 
 public:
     /**
-     * @brief Constructs the SignUpWindow with a specified database connection.
-     * @param db The database connection reference.
+     * @brief Constructs the SignUpWindow with a specified database service.
+     * @param db The database service that runs the registration queries.
      * @param parent The parent widget.
      */
-    explicit SignUpWindow(QSqlDatabase db, QWidget *parent = nullptr);
+    explicit SignUpWindow(DatabaseService *db, QWidget *parent = nullptr);
 
     /**
      * @brief Default constructor for SignUpWindow.
@@ -85,7 +85,7 @@ private:
 
 
     Ui::SignUpWindow *ui;                ///< Pointer to the UI components of SignUpWindow.
-    QSqlDatabase m_db;                   ///< Database connection reference.
+    DatabaseService *m_db;               ///< Database service running the registration queries.
     PasswordManager *m_passwordManager;  ///< Manages password hashing and validation
     int m_passwordStrength;              ///< Current password strength
     bool m_passwordsMatch;               ///< Current password match status
@@ -0,0 +1,133 @@
+#include "StatementCache.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QDebug>
+#include <algorithm>
+
+// Caches are intentionally never destroyed implicitly: their statements must go before the
+// connection's driver, which static destruction order cannot guarantee. release() frees them.
+static QMutex cachesMutex;
+static QHash<QString, StatementCache *> &caches()
+{
+    static QHash<QString, StatementCache *> instances;
+    return instances;
+}
+
+StatementCache::StatementCache(const QSqlDatabase &db)
+    : m_db(db)
+    , m_hits(0)
+    , m_misses(0)
+{
+}
+
+StatementCache &StatementCache::forDatabase(const QSqlDatabase &db)
+{
+    QMutexLocker locker(&cachesMutex);
+    StatementCache *&cache = caches()[db.connectionName()];
+    if (!cache) {
+        cache = new StatementCache(db);
+    }
+    return *cache;
+}
+
+void StatementCache::release(const QSqlDatabase &db)
+{
+    QMutexLocker locker(&cachesMutex);
+    delete caches().take(db.connectionName());
+}
+
+QSqlQuery &StatementCache::prepare(const QString &sql, bool *ok)
+{
+    auto it = m_entries.find(sql);
+    if (it != m_entries.end()) {
+        Entry &entry = *it->second;
+        entry.query.finish();
+        if (entry.prepared) {
+            ++m_hits;
+            if (ok) *ok = true;
+            return entry.query;
+        }
+        // A failed prepare is retried, e.g. after the table it refers to was created
+        ++m_misses;
+        entry.prepared = entry.query.prepare(sql);
+        if (!entry.prepared) {
+            qWarning() << "Failed to prepare statement:" << sql << entry.query.lastError().text();
+        }
+        if (ok) *ok = entry.prepared;
+        return entry.query;
+    }
+
+    ++m_misses;
+    auto entry = std::make_unique<Entry>(m_db);
+    entry->prepared = entry->query.prepare(sql);
+    if (!entry->prepared) {
+        qWarning() << "Failed to prepare statement:" << sql << entry->query.lastError().text();
+    }
+
+    if (ok) *ok = entry->prepared;
+
+    Entry *raw = entry.get();
+    m_entriesByQuery[&raw->query] = raw;
+    m_entries.emplace(sql, std::move(entry));
+    return raw->query;
+}
+
+bool StatementCache::exec(QSqlQuery &query)
+{
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = query.exec();
+    qint64 elapsed = timer.nsecsElapsed();
+
+    auto it = m_entriesByQuery.find(&query);
+    if (it != m_entriesByQuery.end()) {
+        Entry &entry = *it->second;
+        ++entry.executions;
+        entry.totalNs += elapsed;
+        entry.maxNs = std::max(entry.maxNs, elapsed);
+    }
+    return ok;
+}
+
+quint64 StatementCache::hits() const
+{
+    return m_hits;
+}
+
+quint64 StatementCache::misses() const
+{
+    return m_misses;
+}
+
+std::vector<StatementCache::StatementStats> StatementCache::statistics() const
+{
+    std::vector<StatementStats> stats;
+    stats.reserve(m_entries.size());
+    for (const auto &item : m_entries) {
+        const Entry &entry = *item.second;
+        stats.push_back({item.first, entry.executions, entry.totalNs, entry.maxNs});
+    }
+
+    std::sort(stats.begin(), stats.end(), [](const StatementStats &a, const StatementStats &b) {
+        return a.totalNs > b.totalNs;
+    });
+    return stats;
+}
+
+void StatementCache::logStatistics() const
+{
+    qInfo() << "Statement cache" << m_db.connectionName() << "- hits:" << m_hits << "misses:" << m_misses;
+    for (const StatementStats &s : statistics()) {
+        double totalMs = s.totalNs / 1e6;
+        double avgUs = s.executions ? s.totalNs / 1e3 / s.executions : 0.0;
+        qInfo().noquote() << QString("  %1 execs, %2 ms total, %3 us avg, %4 us max: %5")
+                                 .arg(s.executions)
+                                 .arg(totalMs, 0, 'f', 2)
+                                 .arg(avgUs, 0, 'f', 1)
+                                 .arg(s.maxNs / 1e3, 0, 'f', 1)
+                                 .arg(s.sql.simplified());
+    }
+}
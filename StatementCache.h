@@ -0,0 +1,123 @@
+#ifndef STATEMENTCACHE_H
+#define STATEMENTCACHE_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <map>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief The StatementCache class keeps prepared statements alive per database connection.
+ *
+ * Each SQL string is prepared once per connection and handed out again on later requests,
+ * with its previous result set finished and its bindings ready to be overwritten. The cache
+ * counts hits and misses and times every execution so the dominant queries can be found.
+ *
+ * Typical use:
+ * @code
+ * StatementCache &cache = StatementCache::forDatabase(db);
+ * QSqlQuery &query = cache.prepare("SELECT ... WHERE id=?");
+ * query.addBindValue(id);
+ * if (cache.exec(query) && query.next()) { ... }
+ * query.finish();
+ * @endcode
+ *
+ * A cache belongs to one connection and, like the connection, must only be used from the
+ * thread that opened it. Call release() before closing or removing the connection.
+ */
+class StatementCache {
+public:
+    /**
+     * @brief Execution statistics of one cached statement.
+     */
+    struct StatementStats {
+        QString sql;         ///< The statement text.
+        quint64 executions;  ///< Number of exec() calls.
+        qint64 totalNs;      ///< Total time spent in exec(), in nanoseconds.
+        qint64 maxNs;        ///< Slowest single exec(), in nanoseconds.
+    };
+
+    /**
+     * @brief Retrieves the cache of a connection, creating it on first use.
+     * @param db The connection whose statements are cached.
+     * @return The connection's cache.
+     */
+    static StatementCache &forDatabase(const QSqlDatabase &db);
+
+    /**
+     * @brief Destroys the cache of a connection and all of its prepared statements.
+     * @param db The connection whose cache is released.
+     */
+    static void release(const QSqlDatabase &db);
+
+    /**
+     * @brief Retrieves a prepared statement for the given SQL, preparing it on a miss.
+     *
+     * A reused statement is finished first, so any unread rows of its previous execution
+     * are discarded. The returned reference stays valid until release() is called.
+     *
+     * @param sql The statement text.
+     * @param ok If not null, receives whether the statement is prepared.
+     * @return The prepared query; executing it fails if preparing failed.
+     */
+    QSqlQuery &prepare(const QString &sql, bool *ok = nullptr);
+
+    /**
+     * @brief Executes a statement obtained from prepare() and records its timing.
+     * @param query The statement to execute.
+     * @return The result of QSqlQuery::exec().
+     */
+    bool exec(QSqlQuery &query);
+
+    /**
+     * @brief Retrieves the number of prepare() calls served from the cache.
+     * @return The hit count.
+     */
+    quint64 hits() const;
+
+    /**
+     * @brief Retrieves the number of prepare() calls that had to prepare a new statement.
+     * @return The miss count.
+     */
+    quint64 misses() const;
+
+    /**
+     * @brief Retrieves per-statement statistics, slowest total time first.
+     * @return One entry per cached statement.
+     */
+    std::vector<StatementStats> statistics() const;
+
+    /**
+     * @brief Logs the hit/miss counters and per-statement statistics.
+     */
+    void logStatistics() const;
+
+private:
+    /**
+     * @brief A prepared statement together with its statistics.
+     */
+    struct Entry {
+        explicit Entry(const QSqlDatabase &db) : query(db) {}
+        QSqlQuery query;       ///< The prepared statement.
+        bool prepared = false; ///< True if prepare() succeeded.
+        quint64 executions = 0; ///< Number of exec() calls.
+        qint64 totalNs = 0;    ///< Total exec() time in nanoseconds.
+        qint64 maxNs = 0;      ///< Slowest exec() in nanoseconds.
+    };
+
+    /**
+     * @brief Constructs an empty cache for a connection.
+     * @param db The connection.
+     */
+    explicit StatementCache(const QSqlDatabase &db);
+
+    QSqlDatabase m_db; ///< The connection statements are prepared on.
+    std::map<QString, std::unique_ptr<Entry>> m_entries; ///< Cached statements keyed by SQL text.
+    std::map<const QSqlQuery *, Entry *> m_entriesByQuery; ///< Reverse lookup used by exec().
+    quint64 m_hits; ///< prepare() calls served from the cache.
+    quint64 m_misses; ///< prepare() calls that prepared a new statement.
+};
+
+#endif // STATEMENTCACHE_H
@@ -0,0 +1,95 @@
+#include "StringInterner.h"
+#include <QtAlgorithms>
+#include <atomic>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+const quint32 FirstSegmentSize = 256; // Segment k holds FirstSegmentSize << k strings
+const int MaxSegments = 24;
+
+/**
+ * @brief The strings, in segments that double in size so none is ever reallocated.
+ */
+struct Storage {
+    std::mutex mutex;                                      ///< Guards ids, count and segment creation.
+    std::unordered_map<std::string_view, quint32> ids;     ///< Lookup; keys point into the segments.
+    std::atomic<std::string *> segments[MaxSegments] = {}; ///< Allocated on demand, never freed.
+    std::atomic<quint32> count{0};                         ///< Number of strings stored.
+
+    Storage() { add(std::string()); }
+
+    quint32 add(const std::string &text);
+};
+
+/**
+ * @brief Finds the segment and the offset within it of an id.
+ */
+inline void locate(quint32 id, int &segment, quint32 &offset)
+{
+    const quint32 block = id / FirstSegmentSize + 1;
+    segment = 31 - qCountLeadingZeroBits(block);
+    offset = id - FirstSegmentSize * ((1u << segment) - 1);
+}
+
+quint32 Storage::add(const std::string &text)
+{
+    const quint32 id = count.load(std::memory_order_relaxed);
+    int segment;
+    quint32 offset;
+    locate(id, segment, offset);
+    Q_ASSERT(segment < MaxSegments);
+
+    std::string *strings = segments[segment].load(std::memory_order_relaxed);
+    if (!strings) {
+        strings = new std::string[FirstSegmentSize << segment];
+        segments[segment].store(strings, std::memory_order_release);
+    }
+    strings[offset] = text;
+    ids.emplace(std::string_view(strings[offset]), id);
+    count.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+Storage &storage()
+{
+    static Storage instance;
+    return instance;
+}
+
+} // namespace
+
+quint32 StringInterner::intern(const std::string &text)
+{
+    Storage &s = storage();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.ids.find(std::string_view(text));
+    return it != s.ids.end() ? it->second : s.add(text);
+}
+
+bool StringInterner::find(const std::string &text, quint32 &id)
+{
+    Storage &s = storage();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.ids.find(std::string_view(text));
+    if (it == s.ids.end()) {
+        return false;
+    }
+    id = it->second;
+    return true;
+}
+
+const std::string &StringInterner::lookup(quint32 id)
+{
+    int segment;
+    quint32 offset;
+    locate(id, segment, offset);
+    return storage().segments[segment].load(std::memory_order_acquire)[offset];
+}
+
+quint32 StringInterner::size()
+{
+    return storage().count.load(std::memory_order_acquire);
+}
@@ -0,0 +1,51 @@
+#ifndef STRINGINTERNER_H
+#define STRINGINTERNER_H
+
+#include <QtGlobal>
+#include <string>
+
+/**
+ * @brief The StringInterner class maps the process's category, subcategory and type strings to small ids.
+ *
+ * Each distinct string is stored once and keeps its id for the life of the process, so
+ * transactions, ledgers and filters can hold and compare 32-bit ids instead of strings.
+ * Id 0 is always the empty string.
+ *
+ * Interning takes a lock and may be called from any thread. Looking up an id does not
+ * lock: strings are stored in segments that are never moved, and an id can only be held
+ * by a thread after the call that created it returned.
+ */
+class StringInterner {
+public:
+    static const quint32 EmptyId = 0; ///< Id of the empty string.
+
+    /**
+     * @brief Retrieves the id of a string, adding the string if it is new.
+     * @param text The string.
+     * @return The id.
+     */
+    static quint32 intern(const std::string &text);
+
+    /**
+     * @brief Looks up the id of a string without adding it.
+     * @param text The string.
+     * @param id Receives the id if found.
+     * @return true if the string has an id, false otherwise.
+     */
+    static bool find(const std::string &text, quint32 &id);
+
+    /**
+     * @brief Retrieves the string of an id.
+     * @param id An id returned by intern() or find().
+     * @return The string; the reference stays valid for the life of the process.
+     */
+    static const std::string &lookup(quint32 id);
+
+    /**
+     * @brief Retrieves the number of strings interned so far; every id is less than this.
+     * @return The string count.
+     */
+    static quint32 size();
+};
+
+#endif // STRINGINTERNER_H
@@ -1,32 +1,52 @@
 #include "Transaction.h"
+#include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QVariant>
 #include <QDebug>
+#include "StatementCache.h"
+#include "TransactionCursor.h"
+#include <algorithm>
+
+namespace {
+
+quint32 incomeTypeId()
+{
+    static const quint32 id = StringInterner::intern("Income");
+    return id;
+}
+
+quint32 expenseTypeId()
+{
+    static const quint32 id = StringInterner::intern("Expense");
+    return id;
+}
+
+} // namespace
 
 Transaction::Transaction()
     : id(0),
     userId(0),
-    date("1970-01-01"),
-    category(""),
-    subcategory(""),
-    amount(0.0),
-    type("Expense"),
+    day(0),
+    categoryId(StringInterner::EmptyId),
+    subcategoryId(StringInterner::EmptyId),
+    amount(),
+    typeId(expenseTypeId()),
     taxWithheld(false),
     taxAmount(0.0)
 {
 }
 
-Transaction::Transaction(int id, int userId, const std::string &date, const std::string &category,
-                         const std::string &subcategory, double amount, const std::string &type,
+Transaction::Transaction(int id, int userId, int day, const std::string &category,
+                         const std::string &subcategory, Money amount, const std::string &type,
                          bool taxWithheld, double taxAmount)
     : id(id),
     userId(userId),
-    date(date),
-    category(category),
-    subcategory(subcategory),
+    day(day),
+    categoryId(StringInterner::intern(category)),
+    subcategoryId(StringInterner::intern(subcategory)),
     amount(amount),
-    type(type),
+    typeId(StringInterner::intern(type)),
     taxWithheld(taxWithheld),
     taxAmount(taxAmount)
 {
@@ -35,40 +55,55 @@ Transaction::Transaction(int id, int userId, const std::string &date, const std:
 // Getters
 int Transaction::getId() const { return id; }
 int Transaction::getUserId() const { return userId; }
-std::string Transaction::getDate() const { return date; }
-std::string Transaction::getCategory() const { return category; }
-std::string Transaction::getSubcategory() const { return subcategory; }
-double Transaction::getAmount() const { return amount; }
-std::string Transaction::getType() const { return type; }
-bool Transaction::isIncomeTransaction() const { return (type == "Income"); }
+int Transaction::getDay() const { return day; }
+std::string Transaction::getDate() const { return DateUtil::format(day); }
+const std::string &Transaction::getCategory() const { return StringInterner::lookup(categoryId); }
+quint32 Transaction::getCategoryId() const { return categoryId; }
+const std::string &Transaction::getSubcategory() const { return StringInterner::lookup(subcategoryId); }
+quint32 Transaction::getSubcategoryId() const { return subcategoryId; }
+Money Transaction::getAmount() const { return amount; }
+const std::string &Transaction::getType() const { return StringInterner::lookup(typeId); }
+quint32 Transaction::getTypeId() const { return typeId; }
+bool Transaction::isIncomeTransaction() const { return typeId == incomeTypeId(); }
 bool Transaction::isTaxWithheld() const { return taxWithheld; }
 double Transaction::getTaxAmount() const { return taxAmount; }
 
 // Setters
 void Transaction::setId(int id) { this->id = id; }
 void Transaction::setUserId(int userId) { this->userId = userId; }
-void Transaction::setDate(const std::string &date) { this->date = date; }
-void Transaction::setCategory(const std::string &category) { this->category = category; }
-void Transaction::setSubcategory(const std::string &subcategory) { this->subcategory = subcategory; }
-void Transaction::setAmount(double amount) { this->amount = amount; }
-void Transaction::setType(const std::string &type) { this->type = type; }
+void Transaction::setDay(int day) { this->day = day; }
+
+void Transaction::setDate(const std::string &date) {
+    int parsed = DateUtil::parse(date);
+    if (parsed == DateUtil::InvalidDay) {
+        qWarning() << "Ignoring invalid transaction date:" << QString::fromStdString(date);
+        return;
+    }
+    day = parsed;
+}
+void Transaction::setCategory(const std::string &category) { this->categoryId = StringInterner::intern(category); }
+void Transaction::setCategoryId(quint32 id) { this->categoryId = id; }
+void Transaction::setSubcategory(const std::string &subcategory) { this->subcategoryId = StringInterner::intern(subcategory); }
+void Transaction::setSubcategoryId(quint32 id) { this->subcategoryId = id; }
+void Transaction::setAmount(Money amount) { this->amount = amount; }
+void Transaction::setType(const std::string &type) { this->typeId = StringInterner::intern(type); }
+void Transaction::setTypeId(quint32 id) { this->typeId = id; }
 void Transaction::setTaxWithheld(bool withheld) { this->taxWithheld = withheld; }
 void Transaction::setTaxAmount(double amount) { this->taxAmount = amount; }
 
-double Transaction::calculateNetAmount() const {
-    if (type == "Income" && taxWithheld) {
+Money Transaction::calculateNetAmount() const {
+    if (isIncomeTransaction() && taxWithheld) {
         // Ensure taxAmount represents a valid percentage
         if (taxAmount < 0.0) {
             qWarning() << "Invalid tax percentage:" << taxAmount << ". Setting to 0%.";
             return amount;
         } else if (taxAmount > 100.0) {
             qWarning() << "Tax percentage exceeds 100%:" << taxAmount << ". Setting to 100%.";
-            return 0.0;
+            return Money();
         }
 
         // Calculate tax based on percentage
-        double tax = (amount * taxAmount) / 100.0;
-        return amount - tax;
+        return amount - amount.percentage(taxAmount);
     }
     return amount;
 }
@@ -76,60 +111,161 @@ double Transaction::calculateNetAmount() const {
 std::string Transaction::toString() const {
     return "ID: " + std::to_string(id) +
            ", UserID: " + std::to_string(userId) +
-           ", Date: " + date +
-           ", Category: " + category +
-           ", Subcategory: " + subcategory +
-           ", Amount: " + std::to_string(amount) +
-           ", Type: " + type +
+           ", Date: " + getDate() +
+           ", Category: " + getCategory() +
+           ", Subcategory: " + getSubcategory() +
+           ", Amount: " + amount.toStdString() +
+           ", Type: " + getType() +
            ", TaxWithheld: " + (taxWithheld ? "Yes" : "No") +
            ", TaxAmount: " + std::to_string(taxAmount);
 }
 
-std::vector<Transaction> Transaction::readAllTransactions()
+Transaction Transaction::fromQuery(const QSqlQuery &query)
 {
-    std::vector<Transaction> transactions;
-    QSqlQuery query("SELECT id, userId, date, category, subcategory, amount, type, taxWithheld, taxAmount FROM transactions ORDER BY date ASC");
-
-    if (!query.exec()) {
-        qWarning() << "Failed to read transactions:" << query.lastError().text();
-        return transactions;
-    }
+    Transaction t;
+    t.setId(query.value("id").toInt());
+    t.setUserId(query.value("userId").toInt());
+    t.setDay(query.value("day").toInt());
+    t.setCategory(query.value("category").toString().toStdString());
+    t.setSubcategory(query.value("subcategory").toString().toStdString());
+    t.setAmount(Money::fromCents(query.value("amountCents").toLongLong()));
+    t.setType(query.value("type").toString().toStdString());
+    t.setTaxWithheld(query.value("taxWithheld").toInt() == 1);
+    t.setTaxAmount(query.value("taxAmount").toDouble());
+    return t;
+}
 
-    while (query.next()) {
-        Transaction t;
-        t.setId(query.value("id").toInt());
-        t.setUserId(query.value("userId").toInt());
-        t.setDate(query.value("date").toString().toStdString());
-        t.setCategory(query.value("category").toString().toStdString());
-        t.setSubcategory(query.value("subcategory").toString().toStdString());
-        t.setAmount(query.value("amount").toDouble());
-        t.setType(query.value("type").toString().toStdString());
-        t.setTaxWithheld(query.value("taxWithheld").toInt() == 1);
-        t.setTaxAmount(query.value("taxAmount").toDouble());
+std::vector<Transaction> Transaction::readAllTransactions(QSqlDatabase &db)
+{
+    std::vector<Transaction> transactions;
+    TransactionCursor cursor(db, TransactionCursor::AllUsers);
+    cursor.forEach([&transactions](const Transaction &t) {
         transactions.push_back(t);
-    }
+        return true;
+    });
+    return transactions;
+}
 
+std::vector<Transaction> Transaction::readTransactionsForUser(QSqlDatabase &db, int userId, int fromDay, int toDay)
+{
+    std::vector<Transaction> transactions;
+    TransactionCursor cursor(db, userId, fromDay, toDay);
+    cursor.forEach([&transactions](const Transaction &t) {
+        transactions.push_back(t);
+        return true;
+    });
     return transactions;
 }
 
-bool Transaction::writeTransaction(const Transaction &transaction)
+// Column list shared by the single-row and batched insert paths.
+static const char *const kInsertTransactionSql =
+    "INSERT INTO transactions (userId, day, category, subcategory, amountCents, type, taxWithheld, taxAmount) "
+    "VALUES (:userId, :day, :category, :subcategory, :amountCents, :type, :taxWithheld, :taxAmount)";
+
+// Binds the fields of a transaction to a query prepared from kInsertTransactionSql.
+static void bindTransaction(QSqlQuery &query, const Transaction &transaction)
 {
-    QSqlQuery query;
-    query.prepare("INSERT INTO transactions (userId, date, category, subcategory, amount, type, taxWithheld, taxAmount) "
-                  "VALUES (:userId, :date, :category, :subcategory, :amount, :type, :taxWithheld, :taxAmount)");
     query.bindValue(":userId", transaction.getUserId());
-    query.bindValue(":date", QString::fromStdString(transaction.getDate()));
+    query.bindValue(":day", transaction.getDay());
     query.bindValue(":category", QString::fromStdString(transaction.getCategory()));
     query.bindValue(":subcategory", QString::fromStdString(transaction.getSubcategory()));
-    query.bindValue(":amount", transaction.getAmount());
+    query.bindValue(":amountCents", transaction.getAmount().toCents());
     query.bindValue(":type", QString::fromStdString(transaction.getType()));
     query.bindValue(":taxWithheld", transaction.isTaxWithheld() ? 1 : 0);
     query.bindValue(":taxAmount", transaction.getTaxAmount());
+}
 
-    if (!query.exec()) {
+// Binds the fields of a new row to a query prepared from kInsertTransactionSql.
+static void bindTransaction(QSqlQuery &query, const Transaction::NewRow &row)
+{
+    query.bindValue(":userId", row.userId);
+    query.bindValue(":day", row.day);
+    query.bindValue(":category", row.category);
+    query.bindValue(":subcategory", row.subcategory);
+    query.bindValue(":amountCents", row.amount.toCents());
+    query.bindValue(":type", row.type);
+    query.bindValue(":taxWithheld", row.taxWithheld ? 1 : 0);
+    query.bindValue(":taxAmount", row.taxAmount);
+}
+
+// Inserts each row with the cached statement; the caller owns the enclosing transaction.
+template <typename Row>
+static std::vector<int> insertRows(QSqlDatabase &db, const std::vector<Row> &rows)
+{
+    std::vector<int> ids(rows.size(), 0);
+    if (rows.empty()) {
+        return ids;
+    }
+
+    StatementCache &cache = StatementCache::forDatabase(db);
+    bool prepared = false;
+    QSqlQuery &query = cache.prepare(kInsertTransactionSql, &prepared);
+    if (!prepared) {
+        qWarning() << "Failed to prepare transaction insert:" << query.lastError().text();
+        return ids;
+    }
+
+    int failures = 0;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        bindTransaction(query, rows[i]);
+        if (!cache.exec(query)) {
+            qWarning() << "Failed to insert transaction at row" << i << ":" << query.lastError().text();
+            ++failures;
+            continue;
+        }
+        ids[i] = query.lastInsertId().toInt();
+    }
+
+    if (failures > 0) {
+        qWarning() << "Inserted" << (rows.size() - failures) << "of" << rows.size() << "transactions";
+    }
+
+    return ids;
+}
+
+int Transaction::writeTransaction(QSqlDatabase &db, const Transaction &transaction)
+{
+    StatementCache &cache = StatementCache::forDatabase(db);
+    QSqlQuery &query = cache.prepare(kInsertTransactionSql);
+    bindTransaction(query, transaction);
+
+    if (!cache.exec(query)) {
         qWarning() << "Failed to insert transaction:" << query.lastError().text();
-        return false;
+        return 0;
+    }
+
+    return query.lastInsertId().toInt();
+}
+
+std::vector<int> Transaction::writeTransactions(QSqlDatabase &db, const std::vector<Transaction> &transactions)
+{
+    std::vector<int> ids(transactions.size(), 0);
+    if (transactions.empty()) {
+        return ids;
+    }
+
+    // Without its own transaction every row would be committed, and synced, separately
+    if (!db.transaction()) {
+        qWarning() << "Failed to begin transaction batch:" << db.lastError().text();
+        return ids;
+    }
+
+    ids = writeTransactionsInTransaction(db, transactions);
+
+    if (!db.commit()) {
+        qWarning() << "Failed to commit transaction batch:" << db.lastError().text();
+        db.rollback();
+        std::fill(ids.begin(), ids.end(), 0);
     }
+    return ids;
+}
 
-    return true;
+std::vector<int> Transaction::writeTransactionsInTransaction(QSqlDatabase &db, const std::vector<Transaction> &transactions)
+{
+    return insertRows(db, transactions);
+}
+
+std::vector<int> Transaction::writeRowsInTransaction(QSqlDatabase &db, const std::vector<NewRow> &rows)
+{
+    return insertRows(db, rows);
 }
@@ -1,15 +1,42 @@
 #ifndef TRANSACTION_H
 #define TRANSACTION_H
 
+#include <QSqlDatabase>
+#include <QString>
+#include "DateUtil.h"
+#include "Money.h"
+#include "StringInterner.h"
 #include <string>
 #include <vector>
 
+class QSqlQuery;
+
 /**
  * @brief The Transaction class represents a single financial transaction,
  * either income or expense, with associated details, including optional tax withholding.
+ *
+ * Category, subcategory and type are held as StringInterner ids, so copies are cheap and
+ * comparisons can use the ids instead of the strings.
  */
 class Transaction {
 public:
+    /**
+     * @brief The fields of a transaction that is only written to the database.
+     *
+     * Holds its strings itself instead of interning them, so bulk writes such as a CSV import
+     * do not grow the process-wide StringInterner with text no Ledger may ever hold.
+     */
+    struct NewRow {
+        int userId = 0;           ///< Identifier of the owning user.
+        int day = 0;              ///< Date as a DateUtil day number.
+        QString category;         ///< Main category.
+        QString subcategory;      ///< Subcategory or memo.
+        Money amount;             ///< Positive amount.
+        QString type;             ///< "Income" or "Expense".
+        bool taxWithheld = false; ///< Whether tax was withheld.
+        double taxAmount = 0.0;   ///< Percentage of tax withheld, if any.
+    };
+
     /**
      * @brief Default constructor initializes a Transaction with default values.
      * Sets all numerical values to zero and strings to empty.
@@ -20,16 +47,16 @@ public:
      * @brief Constructs a Transaction with specified details.
      * @param id The unique identifier for the transaction.
      * @param userId The identifier of the user associated with the transaction.
-     * @param date The date of the transaction in "YYYY-MM-DD" format.
+     * @param day The date of the transaction as a DateUtil day number.
      * @param category The main category of the transaction (e.g., "Salary", "Groceries").
      * @param subcategory The subcategory of the transaction (e.g., "Bonus", "Vegetables").
      * @param amount The monetary amount of the transaction.
      * @param type The type of transaction, either "Income" or "Expense".
      * @param taxWithheld Indicates whether tax was withheld for this transaction.
-     * @param taxAmount The amount of tax withheld, if any.
+     * @param taxAmount The percentage of tax withheld, if any.
      */
-    Transaction(int id, int userId, const std::string &date, const std::string &category,
-                const std::string &subcategory, double amount, const std::string &type,
+    Transaction(int id, int userId, int day, const std::string &category,
+                const std::string &subcategory, Money amount, const std::string &type,
                 bool taxWithheld = false, double taxAmount = 0.0);
 
     // Getters
@@ -47,7 +74,13 @@ public:
     int getUserId() const;
 
     /**
-     * @brief Retrieves the date of the transaction.
+     * @brief Retrieves the date of the transaction as a day number.
+     * @return Days since 1970-01-01; see DateUtil.
+     */
+    int getDay() const;
+
+    /**
+     * @brief Retrieves the date of the transaction for display.
      * @return The transaction date as a std::string in "YYYY-MM-DD" format.
      */
     std::string getDate() const;
@@ -56,25 +89,43 @@ public:
      * @brief Retrieves the category of the transaction.
      * @return The transaction category as a std::string.
      */
-    std::string getCategory() const;
+    const std::string &getCategory() const;
+
+    /**
+     * @brief Retrieves the interned id of the category.
+     * @return The StringInterner id.
+     */
+    quint32 getCategoryId() const;
 
     /**
      * @brief Retrieves the subcategory of the transaction.
      * @return The transaction subcategory as a std::string.
      */
-    std::string getSubcategory() const;
+    const std::string &getSubcategory() const;
+
+    /**
+     * @brief Retrieves the interned id of the subcategory.
+     * @return The StringInterner id.
+     */
+    quint32 getSubcategoryId() const;
 
     /**
      * @brief Retrieves the amount of the transaction.
-     * @return The transaction amount as a double.
+     * @return The transaction amount.
      */
-    double getAmount() const;
+    Money getAmount() const;
 
     /**
      * @brief Retrieves the type of the transaction.
      * @return The transaction type as a std::string ("Income" or "Expense").
      */
-    std::string getType() const;
+    const std::string &getType() const;
+
+    /**
+     * @brief Retrieves the interned id of the type.
+     * @return The StringInterner id.
+     */
+    quint32 getTypeId() const;
 
     /**
      * @brief Checks if the transaction is an income transaction.
@@ -89,8 +140,8 @@ public:
     bool isTaxWithheld() const;
 
     /**
-     * @brief Retrieves the amount of tax withheld for the transaction.
-     * @return The tax amount as a double.
+     * @brief Retrieves the percentage of tax withheld for the transaction.
+     * @return The tax percentage, 0-100.
      */
     double getTaxAmount() const;
 
@@ -110,7 +161,13 @@ public:
 
     /**
      * @brief Sets the date of the transaction.
-     * @param date The new transaction date in "YYYY-MM-DD" format.
+     * @param day The new transaction date as a day number; see DateUtil.
+     */
+    void setDay(int day);
+
+    /**
+     * @brief Sets the date of the transaction from text.
+     * @param date The new transaction date in "YYYY-MM-DD" format; invalid dates are ignored.
      */
     void setDate(const std::string &date);
 
@@ -120,17 +177,29 @@ public:
      */
     void setCategory(const std::string &category);
 
+    /**
+     * @brief Sets the category from an interned id.
+     * @param id A StringInterner id.
+     */
+    void setCategoryId(quint32 id);
+
     /**
      * @brief Sets the subcategory of the transaction.
      * @param subcategory The new transaction subcategory.
      */
     void setSubcategory(const std::string &subcategory);
 
+    /**
+     * @brief Sets the subcategory from an interned id.
+     * @param id A StringInterner id.
+     */
+    void setSubcategoryId(quint32 id);
+
     /**
      * @brief Sets the amount of the transaction.
      * @param amount The new transaction amount.
      */
-    void setAmount(double amount);
+    void setAmount(Money amount);
 
     /**
      * @brief Sets the type of the transaction.
@@ -138,6 +207,12 @@ public:
      */
     void setType(const std::string &type);
 
+    /**
+     * @brief Sets the type from an interned id.
+     * @param id A StringInterner id.
+     */
+    void setTypeId(quint32 id);
+
     /**
      * @brief Sets whether tax was withheld for the transaction.
      * @param withheld `true` if tax is withheld, `false` otherwise.
@@ -145,8 +220,8 @@ public:
     void setTaxWithheld(bool withheld);
 
     /**
-     * @brief Sets the amount of tax withheld for the transaction.
-     * @param amount The new tax amount.
+     * @brief Sets the percentage of tax withheld for the transaction.
+     * @param amount The new tax percentage, 0-100.
      */
     void setTaxAmount(double amount);
 
@@ -154,11 +229,11 @@ public:
      * @brief Calculates the net amount after applying tax withholding.
      *
      * For income transactions where tax is withheld, this method calculates the net amount
-     * by subtracting the tax percentage from the gross amount.
+     * by subtracting the tax percentage from the gross amount, rounded to the nearest cent.
      *
      * @return The net amount after tax withholding if applicable; otherwise, the original amount.
      */
-    double calculateNetAmount() const;
+    Money calculateNetAmount() const;
 
     /**
      * @brief Converts the transaction details to a readable string format.
@@ -168,29 +243,97 @@ public:
 
     // DB Methods
 
+    /**
+     * @brief Builds a Transaction from the current row of a query selecting all transaction columns.
+     * @param query A query positioned on a row.
+     * @return The transaction held in that row.
+     */
+    static Transaction fromQuery(const QSqlQuery &query);
+
     /**
      * @brief Reads all transactions from the database.
-     * @return A vector containing all Transaction objects retrieved from the database.
+     *
+     * Every row is held in the returned vector; use TransactionCursor to consume a large
+     * table page by page instead.
+     *
+     * @param db The connection to read from.
+     * @return A vector containing all Transaction objects retrieved from the database, ordered by date.
      */
-    static std::vector<Transaction> readAllTransactions();
+    static std::vector<Transaction> readAllTransactions(QSqlDatabase &db);
+
+    /**
+     * @brief Reads the transactions of a single user, optionally limited to a date range.
+     *
+     * The user and date filters are applied in SQL and served by the (userId, date) index,
+     * so the cost depends on the size of this user's history rather than the whole table.
+     * Use TransactionCursor to consume the rows page by page instead.
+     *
+     * @param db The connection to read from.
+     * @param userId The identifier of the user whose transactions are loaded.
+     * @param fromDay Inclusive lower bound as a day number.
+     * @param toDay Inclusive upper bound as a day number.
+     * @return A vector containing the user's transactions ordered by date.
+     */
+    static std::vector<Transaction> readTransactionsForUser(QSqlDatabase &db, int userId, int fromDay = DateUtil::MinDay,
+                                                            int toDay = DateUtil::MaxDay);
 
     /**
      * @brief Writes a new transaction to the database.
+     * @param db The connection to write to.
      * @param transaction The Transaction object to be written to the database.
-     * @return `true` if the transaction was successfully written, `false` otherwise.
+     * @return The row id assigned to the new transaction, or 0 if it could not be written.
+     */
+    static int writeTransaction(QSqlDatabase &db, const Transaction &transaction);
+
+    /**
+     * @brief Writes many new transactions to the database in a single SQLite transaction.
+     *
+     * The insert statement is prepared once and rebound for every row, so a large batch pays
+     * for one commit instead of one per row. Rows that fail to insert are logged with their
+     * index and skipped; the remaining rows are still committed. The connection must not be
+     * inside a transaction already; use writeTransactionsInTransaction() then.
+     *
+     * @param db The connection to write to.
+     * @param transactions The Transaction objects to be written to the database.
+     * @return The row id assigned to each transaction, in input order, or 0 for rows that failed.
+     *         All entries are 0 if the transaction could not be begun or committed.
+     */
+    static std::vector<int> writeTransactions(QSqlDatabase &db, const std::vector<Transaction> &transactions);
+
+    /**
+     * @brief Writes many new transactions inside a transaction the caller has already begun.
+     *
+     * Like writeTransactions(), but neither begins nor commits, so the rows are kept or rolled
+     * back together with the rest of the caller's transaction.
+     *
+     * @param db The connection to write to; a transaction must be open on it.
+     * @param transactions The Transaction objects to be written to the database.
+     * @return The row id assigned to each transaction, in input order, or 0 for rows that failed.
+     */
+    static std::vector<int> writeTransactionsInTransaction(QSqlDatabase &db, const std::vector<Transaction> &transactions);
+
+    /**
+     * @brief Writes many new rows inside a transaction the caller has already begun.
+     *
+     * Like writeTransactionsInTransaction(), but binds the rows' own strings, so nothing is
+     * interned.
+     *
+     * @param db The connection to write to; a transaction must be open on it.
+     * @param rows The rows to be written to the database.
+     * @return The row id assigned to each row, in input order, or 0 for rows that failed.
      */
-    static bool writeTransaction(const Transaction &transaction);
+    static std::vector<int> writeRowsInTransaction(QSqlDatabase &db, const std::vector<NewRow> &rows);
 
 private:
     int id; ///< Unique identifier for the transaction.
     int userId; ///< Identifier of the user associated with the transaction.
-    std::string date; ///< Date of the transaction in "YYYY-MM-DD" format.
-    std::string category; ///< Main category of the transaction.
-    std::string subcategory; ///< Subcategory of the transaction.
-    double amount; ///< Monetary amount of the transaction.
-    std::string type; ///< Type of the transaction ("Income" or "Expense").
+    int day; ///< Date of the transaction as a day number (days since 1970-01-01).
+    quint32 categoryId; ///< Interned main category of the transaction.
+    quint32 subcategoryId; ///< Interned subcategory of the transaction.
+    Money amount; ///< Monetary amount of the transaction.
+    quint32 typeId; ///< Interned type of the transaction ("Income" or "Expense").
     bool taxWithheld; ///< Indicates whether tax was withheld for this transaction.
-    double taxAmount; ///< Amount of tax withheld, if any.
+    double taxAmount; ///< Percentage of tax withheld, if any.
 };
 
 #endif // TRANSACTION_H
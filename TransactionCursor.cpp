@@ -0,0 +1,112 @@
+#include "TransactionCursor.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QDebug>
+#include "StatementCache.h"
+
+// Row-value comparisons let SQLite seek the (userId, day, id, ...) and (day) indexes straight
+// to the first row after the previous page. The first covers every column, so a user's page
+// is read from the index alone however many other users' rows the table holds.
+static const char *const kUserPageSql =
+    "SELECT id, userId, day, category, subcategory, amountCents, type, taxWithheld, taxAmount "
+    "FROM transactions WHERE userId = :userId AND (day, id) > (:afterDay, :afterId) AND day <= :toDay "
+    "ORDER BY day ASC, id ASC LIMIT :pageSize";
+
+static const char *const kAllPageSql =
+    "SELECT id, userId, day, category, subcategory, amountCents, type, taxWithheld, taxAmount "
+    "FROM transactions WHERE (day, id) > (:afterDay, :afterId) AND day <= :toDay "
+    "ORDER BY day ASC, id ASC LIMIT :pageSize";
+
+TransactionCursor::TransactionCursor(QSqlDatabase &db, int userId, int fromDay, int toDay, int pageSize)
+    : m_db(db)
+    , m_userId(userId)
+    , m_toDay(toDay)
+    , m_pageSize(pageSize > 0 ? pageSize : DefaultPageSize)
+    , m_atEnd(false)
+{
+    // Starting "after" (fromDay, -1) includes every row on fromDay
+    m_position.day = fromDay;
+    m_position.id = -1;
+}
+
+bool TransactionCursor::fetchNext(std::vector<Transaction> &page)
+{
+    page.clear();
+    if (m_atEnd) {
+        return false;
+    }
+
+    StatementCache &cache = StatementCache::forDatabase(m_db);
+    QSqlQuery &query = cache.prepare(m_userId != AllUsers ? kUserPageSql : kAllPageSql);
+    if (m_userId != AllUsers) {
+        query.bindValue(":userId", m_userId);
+    }
+    query.bindValue(":afterDay", m_position.day);
+    query.bindValue(":afterId", m_position.id);
+    query.bindValue(":toDay", m_toDay);
+    query.bindValue(":pageSize", m_pageSize);
+
+    if (!cache.exec(query)) {
+        m_error = query.lastError().text();
+        m_atEnd = true;
+        qWarning() << "Failed to read transaction page:" << m_error;
+        return false;
+    }
+
+    page.reserve(m_pageSize);
+    while (query.next()) {
+        page.push_back(Transaction::fromQuery(query));
+    }
+    query.finish();
+
+    if (static_cast<int>(page.size()) < m_pageSize) {
+        m_atEnd = true;
+    }
+    if (page.empty()) {
+        return false;
+    }
+
+    m_position.day = page.back().getDay();
+    m_position.id = page.back().getId();
+    return true;
+}
+
+bool TransactionCursor::forEach(const std::function<bool(const Transaction &)> &visit)
+{
+    std::vector<Transaction> page;
+    while (fetchNext(page)) {
+        for (const Transaction &transaction : page) {
+            if (!visit(transaction)) {
+                return true;
+            }
+        }
+    }
+    return !hasError();
+}
+
+TransactionCursor::Position TransactionCursor::position() const
+{
+    return m_position;
+}
+
+void TransactionCursor::seek(const Position &position)
+{
+    m_position = position;
+    m_atEnd = false;
+}
+
+bool TransactionCursor::atEnd() const
+{
+    return m_atEnd;
+}
+
+bool TransactionCursor::hasError() const
+{
+    return !m_error.isEmpty();
+}
+
+QString TransactionCursor::lastError() const
+{
+    return m_error;
+}
@@ -0,0 +1,108 @@
+#ifndef TRANSACTIONCURSOR_H
+#define TRANSACTIONCURSOR_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <functional>
+#include <vector>
+#include "DateUtil.h"
+#include "Transaction.h"
+
+/**
+ * @brief The TransactionCursor class reads transactions page by page in (day, id) order.
+ *
+ * Each page is fetched with a keyset condition, (day, id) > (last day, last id), and a
+ * LIMIT, never an OFFSET, so every page costs the same index seek no matter how deep into
+ * the table it starts, and only one page of rows is held in memory at a time.
+ *
+ * @code
+ * TransactionCursor cursor(db, userId);
+ * std::vector<Transaction> page;
+ * while (cursor.fetchNext(page)) {
+ *     for (const Transaction &t : page) { ... }
+ * }
+ * if (cursor.hasError()) { ... }
+ * @endcode
+ *
+ * The cursor holds no open statement between pages, so other queries may run on the same
+ * connection in between, and position()/seek() let a read be resumed by a later cursor.
+ */
+class TransactionCursor {
+public:
+    /**
+     * @brief The key of the last row returned; the next page starts strictly after it.
+     */
+    struct Position {
+        int day = DateUtil::MinDay; ///< Day number of the last row.
+        int id = -1;                ///< Id of the last row; -1 before the first row of a day.
+    };
+
+    static constexpr int DefaultPageSize = 500; ///< Rows fetched per page unless specified.
+    static constexpr int AllUsers = -1;         ///< User filter that reads every user's transactions.
+
+    /**
+     * @brief Constructs a cursor over one user's transactions, or all transactions.
+     * @param db The connection to read from; must outlive the cursor.
+     * @param userId The user whose transactions are read, or AllUsers.
+     * @param fromDay Inclusive lower bound as a day number.
+     * @param toDay Inclusive upper bound as a day number.
+     * @param pageSize Maximum number of rows returned by each fetchNext().
+     */
+    TransactionCursor(QSqlDatabase &db, int userId, int fromDay = DateUtil::MinDay,
+                      int toDay = DateUtil::MaxDay, int pageSize = DefaultPageSize);
+
+    /**
+     * @brief Fetches the next page of transactions.
+     * @param page Replaced with the rows of the next page.
+     * @return true if at least one row was fetched, false at the end or on error.
+     */
+    bool fetchNext(std::vector<Transaction> &page);
+
+    /**
+     * @brief Calls a function for every remaining transaction, one page at a time.
+     * @param visit Receives each transaction; returning false stops the read early.
+     * @return false if a query failed, true otherwise.
+     */
+    bool forEach(const std::function<bool(const Transaction &)> &visit);
+
+    /**
+     * @brief Retrieves the key of the last row returned.
+     * @return The current position.
+     */
+    Position position() const;
+
+    /**
+     * @brief Continues reading after the given position, for example one saved by an earlier cursor.
+     * @param position The key of the last row already consumed.
+     */
+    void seek(const Position &position);
+
+    /**
+     * @brief Checks whether the last page has been read.
+     * @return true once a page shorter than the page size (or an error) has been returned.
+     */
+    bool atEnd() const;
+
+    /**
+     * @brief Checks whether a page query failed.
+     * @return true if an error occurred, false otherwise.
+     */
+    bool hasError() const;
+
+    /**
+     * @brief Retrieves the text of the last query error.
+     * @return The error text, or an empty string.
+     */
+    QString lastError() const;
+
+private:
+    QSqlDatabase m_db; ///< The connection pages are read from.
+    int m_userId; ///< The user filter, or AllUsers.
+    int m_toDay; ///< Inclusive upper bound as a day number.
+    int m_pageSize; ///< Maximum rows per page.
+    Position m_position; ///< Key of the last row returned.
+    bool m_atEnd; ///< True once the last page has been read.
+    QString m_error; ///< Text of the last query error.
+};
+
+#endif // TRANSACTIONCURSOR_H
@@ -2,29 +2,18 @@
 #include "ui_TransactionForm.h"
 #include <QMessageBox>
 #include <QDebug>
-#include "Transaction.h"
+#include "Categories.h"
 
 TransactionForm::TransactionForm(QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::TransactionForm)
+    , dbService(nullptr)
 {
     ui->setupUi(this);
 
     ui->dateEdit->setDate(QDate::currentDate());
 
-    const QStringList predefinedCategories = {
-        "Pay",
-        "Groceries",
-        "Rent",
-        "Utilities",
-        "Transportation",
-        "Entertainment",
-        "Healthcare",
-        "Education",
-        "Savings"
-    };
-
-    ui->categoryComboBox->addItems(predefinedCategories);
+    ui->categoryComboBox->addItems(Categories::predefined());
 
     ui->taxWithheldCheckBox->setEnabled(false);
     ui->taxAmountLineEdit->setEnabled(false);
@@ -59,6 +48,11 @@ void TransactionForm::setCurrentUser(const User &user)
     currentUser = user;
 }
 
+void TransactionForm::setDatabaseService(DatabaseService *service)
+{
+    dbService = service;
+}
+
 void TransactionForm::saveTransaction()
 {
     if (!validateTransactionInput()) {
@@ -72,13 +66,13 @@ void TransactionForm::saveTransaction()
         return;
     }
 
-    std::string dateStr = date.toString("yyyy-MM-dd").toStdString();
     std::string category = ui->categoryComboBox->currentText().toStdString();
     std::string subcategory = ui->subcategoryLineEdit->text().toStdString();
-    double amount = ui->amountLineEdit->text().toDouble();
+    bool amountOk = false;
+    Money amount = Money::parse(ui->amountLineEdit->text(), &amountOk);
     std::string type = ui->incomeRadioButton->isChecked() ? "Income" : "Expense";
 
-    if (amount <= 0.0) {
+    if (!amountOk || !amount.isPositive()) {
         ui->errorLabel->setText("Amount must be greater than zero.");
         return;
     }
@@ -86,7 +80,7 @@ void TransactionForm::saveTransaction()
     Transaction transaction;
     transaction.setId(0);
     transaction.setUserId(currentUser.getUserId());
-    transaction.setDate(dateStr);
+    transaction.setDay(DateUtil::fromQDate(date));
     transaction.setCategory(category);
     transaction.setSubcategory(subcategory);
     transaction.setAmount(amount);
@@ -108,12 +102,24 @@ void TransactionForm::saveTransaction()
         transaction.setTaxAmount(0.0);
     }
 
-    if (Transaction::writeTransaction(transaction)) {
-        ui->errorLabel->setText("Transaction saved successfully!");
-        emit transactionSaved();
-    } else {
+    if (!dbService) {
         ui->errorLabel->setText("Failed to write transaction to database.");
+        return;
     }
+
+    ui->savePushButton->setEnabled(false);
+    dbService->submit<int>(this, [transaction](QSqlDatabase &db) {
+        return Transaction::writeTransaction(db, transaction);
+    }, [this, transaction](int transactionId) mutable {
+        ui->savePushButton->setEnabled(true);
+        if (transactionId > 0) {
+            transaction.setId(transactionId);
+            ui->errorLabel->setText("Transaction saved successfully!");
+            emit transactionSaved(transaction);
+        } else {
+            ui->errorLabel->setText("Failed to write transaction to database.");
+        }
+    });
 }
 
 void TransactionForm::cancelTransaction() {
@@ -123,7 +129,8 @@ void TransactionForm::cancelTransaction() {
 bool TransactionForm::validateTransactionInput()
 {
     bool isTypeSelected = ui->incomeRadioButton->isChecked() || ui->expenseRadioButton->isChecked();
-    bool isAmountOk = !ui->amountLineEdit->text().isEmpty() && ui->amountLineEdit->text().toDouble() > 0.0;
+    bool amountOk = false;
+    bool isAmountOk = Money::parse(ui->amountLineEdit->text(), &amountOk).isPositive() && amountOk;
     bool isCategoryOk = !ui->categoryComboBox->currentText().isEmpty();
 
     return isTypeSelected && isAmountOk && isCategoryOk;
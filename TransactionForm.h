@@ -3,6 +3,8 @@
 
 #include <QWidget>
 #include "User.h"
+#include "Transaction.h"
+#include "DatabaseService.h"
 
 namespace Ui {
 class TransactionForm;
@@ -32,6 +34,12 @@ public:
      */
     void setCurrentUser(const User &user);
 
+    /**
+     * @brief Sets the database service used to save transactions.
+     * @param service The database service.
+     */
+    void setDatabaseService(DatabaseService *service);
+
     /**
      * @brief Resets all UI elements to their default state.
      */
@@ -40,8 +48,9 @@ public:
 signals:
     /**
      * @brief Emitted when a transaction is successfully saved.
+     * @param transaction The saved transaction, including the id assigned by the database.
      */
-    void transactionSaved();
+    void transactionSaved(const Transaction &transaction);
 
     /**
      * @brief Emitted when the transaction addition is cancelled.
@@ -62,6 +71,7 @@ private slots:
 private:
     Ui::TransactionForm *ui; ///< Pointer to the UI components of TransactionForm.
     User currentUser; ///< The current user adding the transaction.
+    DatabaseService *dbService; ///< Database service the transaction is saved through.
 
     /**
      * @brief Validates the input fields for the transaction form.
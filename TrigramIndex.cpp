@@ -0,0 +1,100 @@
+#include "TrigramIndex.h"
+#include <algorithm>
+
+std::vector<quint64> TrigramIndex::trigramsOf(const QString &folded)
+{
+    std::vector<quint64> keys;
+    const int length = folded.size();
+    if (length < 3) {
+        return keys;
+    }
+
+    keys.reserve(static_cast<size_t>(length - 2));
+    const QChar *text = folded.constData();
+    for (int i = 0; i + 3 <= length; ++i) {
+        keys.push_back(static_cast<quint64>(text[i].unicode()) << 32
+                       | static_cast<quint64>(text[i + 1].unicode()) << 16
+                       | static_cast<quint64>(text[i + 2].unicode()));
+    }
+    return keys;
+}
+
+void TrigramIndex::add(quint32 document, const QString &text)
+{
+    for (quint64 key : trigramsOf(text.toCaseFolded())) {
+        std::vector<quint32> &documents = postings[key];
+        // A trigram repeated within one text is recorded once
+        if (documents.empty() || documents.back() != document) {
+            documents.push_back(document);
+        }
+    }
+}
+
+bool TrigramIndex::candidates(const QString &needle, std::vector<quint32> &documents) const
+{
+    documents.clear();
+
+    std::vector<quint64> keys = trigramsOf(needle.toCaseFolded());
+    if (keys.empty()) {
+        return false;
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::vector<const std::vector<quint32> *> lists;
+    lists.reserve(keys.size());
+    for (quint64 key : keys) {
+        auto it = postings.find(key);
+        if (it == postings.end()) {
+            return true; // A trigram no document has: nothing can match
+        }
+        lists.push_back(&it->second);
+    }
+
+    // Walk the shortest list and binary search the others, so the work is bounded by the rarest trigram
+    std::sort(lists.begin(), lists.end(), [](const std::vector<quint32> *a, const std::vector<quint32> *b) {
+        return a->size() < b->size();
+    });
+
+    std::vector<std::vector<quint32>::const_iterator> cursors;
+    cursors.reserve(lists.size());
+    for (const auto *list : lists) {
+        cursors.push_back(list->begin());
+    }
+
+    for (quint32 document : *lists.front()) {
+        bool inAll = true;
+        for (size_t i = 1; i < lists.size() && inAll; ++i) {
+            cursors[i] = std::lower_bound(cursors[i], lists[i]->end(), document);
+            if (cursors[i] == lists[i]->end()) {
+                return true;
+            }
+            inAll = *cursors[i] == document;
+        }
+        if (inAll) {
+            documents.push_back(document);
+        }
+    }
+    return true;
+}
+
+void TrigramIndex::clear()
+{
+    postings.clear();
+}
+
+size_t TrigramIndex::trigramCount() const
+{
+    return postings.size();
+}
+
+size_t TrigramIndex::memoryUsage() const
+{
+    // One node per trigram plus the bucket array, as std::unordered_map allocates them
+    size_t bytes = postings.bucket_count() * sizeof(void *)
+                   + postings.size() * (sizeof(void *) + sizeof(std::pair<const quint64, std::vector<quint32>>));
+    for (const auto &entry : postings) {
+        bytes += entry.second.capacity() * sizeof(quint32);
+    }
+    return bytes;
+}
@@ -0,0 +1,66 @@
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <QString>
+#include <QtGlobal>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief The TrigramIndex class finds the documents that may contain a substring.
+ *
+ * Every case-folded three-character window of a document's text is a trigram, mapped to the
+ * ascending list of documents that contain it. A search needs only the posting lists of the
+ * needle's own trigrams and intersects them starting with the shortest, so its cost follows
+ * the number of candidates rather than the number of documents. Candidates contain all of
+ * the needle's trigrams but not necessarily the needle itself, so callers verify them.
+ *
+ * Documents are numbered by the caller and must be added in ascending order.
+ */
+class TrigramIndex {
+public:
+    /**
+     * @brief Indexes a document's text.
+     * @param document The document number; greater than any number added before.
+     * @param text The text to index.
+     */
+    void add(quint32 document, const QString &text);
+
+    /**
+     * @brief Finds the documents containing every trigram of a needle, case-insensitively.
+     * @param needle The text to search for.
+     * @param documents Receives the candidate documents in ascending order.
+     * @return true if the needle was long enough to use the index, false if it is shorter
+     *         than three characters and every document is a candidate.
+     */
+    bool candidates(const QString &needle, std::vector<quint32> &documents) const;
+
+    /**
+     * @brief Removes all documents.
+     */
+    void clear();
+
+    /**
+     * @brief Retrieves the number of distinct trigrams indexed.
+     * @return The trigram count.
+     */
+    size_t trigramCount() const;
+
+    /**
+     * @brief Estimates the heap memory held by the index.
+     * @return The size in bytes.
+     */
+    size_t memoryUsage() const;
+
+private:
+    /**
+     * @brief Collects the distinct trigram keys of a case-folded text.
+     * @param folded The case-folded text.
+     * @return The keys, each packing three UTF-16 code units.
+     */
+    static std::vector<quint64> trigramsOf(const QString &folded);
+
+    std::unordered_map<quint64, std::vector<quint32>> postings; ///< Documents per trigram, ascending.
+};
+
+#endif // TRIGRAMINDEX_H
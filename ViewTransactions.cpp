@@ -3,10 +3,17 @@
 #include <QEvent>
 #include <QMouseEvent>
 #include <QHeaderView>
+#include <algorithm>
+#include "DateUtil.h"
+#include "Categories.h"
 
 ViewTransactions::ViewTransactions(QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::ViewTransactions)
+    , ledgerSubscription(0)
+    , showingBalance(true)
+    , showingTotalRow(false)
+    , filteredTotal()
 {
     ui->setupUi(this);
 
@@ -15,19 +22,8 @@ ViewTransactions::ViewTransactions(QWidget *parent)
     // Make the label clickable
     ui->label->installEventFilter(this);
 
-    const QStringList predefinedCategories = {
-        "Pay",
-        "Groceries",
-        "Rent",
-        "Utilities",
-        "Transportation",
-        "Entertainment",
-        "Healthcare",
-        "Education",
-        "Savings"
-    };
     ui->categoryComboBox->addItem("All");
-    ui->categoryComboBox->addItems(predefinedCategories);
+    ui->categoryComboBox->addItems(Categories::predefined());
 
     // Set table properties
     ui->transactionTableWidget->setEditTriggers(QAbstractItemView::NoEditTriggers);
@@ -43,6 +39,9 @@ ViewTransactions::ViewTransactions(QWidget *parent)
 
 ViewTransactions::~ViewTransactions()
 {
+    if (ledger) {
+        ledger->unsubscribe(ledgerSubscription);
+    }
     delete ui;
 }
 
@@ -62,15 +61,72 @@ void ViewTransactions::toggleOptions()
     ui->label->setText(currentlyVisible ? "Show Options" : "Hide Options");
 }
 
+void ViewTransactions::setLedger(std::shared_ptr<const Ledger> ledger)
+{
+    if (this->ledger) {
+        this->ledger->unsubscribe(ledgerSubscription);
+        ledgerSubscription = 0;
+    }
+    this->ledger = std::move(ledger);
+    if (this->ledger) {
+        ledgerSubscription = this->ledger->subscribe([this](const Ledger::Change &change) {
+            applyLedgerChange(change);
+        });
+    }
+    applyFiltering();
+}
+
+void ViewTransactions::applyLedgerChange(const Ledger::Change &change)
+{
+    if (!change.reset && change.removedIds.empty() && change.inserted.size() == 1) {
+        addTransaction(Ledger::RowView(ledger.get(), change.inserted.front()));
+    } else {
+        applyFiltering();
+    }
+}
+
+void ViewTransactions::refresh()
+{
+    applyFiltering();
+}
+
 void ViewTransactions::setCurrentUser(const User &user)
 {
     currentUser = user;
 }
 
-void ViewTransactions::setAllTransactions(const std::vector<Transaction> &transactions)
+void ViewTransactions::addTransaction(const Ledger::RowView &transaction)
 {
-    allTransactions = transactions;
-    applyFiltering();
+    if (!matchesFilters(transaction))
+        return;
+
+    Money signedAmount = transaction.signedNetAmount();
+
+    int row = tableRowForDay(transaction.getDay());
+    ui->transactionTableWidget->insertRow(row);
+    rowDays.insert(rowDays.begin() + row, transaction.getDay());
+
+    if (showingBalance) {
+        // The row goes after every transaction on its day, so its balance is the ledger's as of that day
+        Money balance = ledger ? ledger->balanceAsOf(transaction.getDay())
+                               : (row > 0 ? rowBalances[row - 1] : Money()) + signedAmount;
+        rowBalances.insert(rowBalances.begin() + row, balance);
+        setRowItems(row, transaction, signedAmount, balance);
+
+        // A backdated transaction shifts the running balance of every later row
+        const int balanceColumn = ui->transactionTableWidget->columnCount() - 1;
+        for (int r = row + 1; r < static_cast<int>(rowBalances.size()); ++r) {
+            rowBalances[r] += signedAmount;
+            ui->transactionTableWidget->item(r, balanceColumn)->setText(rowBalances[r].toString());
+        }
+    } else {
+        setRowItems(row, transaction, signedAmount, Money());
+    }
+
+    filteredTotal += signedAmount;
+    if (!showingBalance && showingTotalRow) {
+        updateTotalRow();
+    }
 }
 
 void ViewTransactions::updateFilters()
@@ -89,30 +145,10 @@ void ViewTransactions::applyFiltering()
     bool hasSubCategoryFilter = !currentSubCategoryFilter.isEmpty();
     bool filtersApplied = hasCategoryFilter || hasSubCategoryFilter;
 
-    // Preallocate space based on allTransactions size to improve performance
-    std::vector<Transaction> filtered;
-    filtered.reserve(allTransactions.size());
-
-    // Apply both category and subcategory filters in one loop
-    for (const auto &t : allTransactions) {
-        // Apply category filter if active
-        if (hasCategoryFilter) {
-            // Convert category once and reuse
-            const QString category = QString::fromStdString(t.getCategory());
-            if (category != currentCategoryFilter)
-                continue; // Skip transactions that do not match the category
-        }
-
-        // Apply subcategory filter if active
-        if (hasSubCategoryFilter) {
-            // Convert subcategory once and reuse
-            const QString subcategory = QString::fromStdString(t.getSubcategory());
-            if (!subcategory.contains(currentSubCategoryFilter, Qt::CaseInsensitive))
-                continue; // Skip transactions that do not match the subcategory
-        }
-
-        // If transaction passes all active filters, add it to the filtered list
-        filtered.emplace_back(t);
+    // Rows point into the shared ledger's columns; nothing is copied
+    std::vector<Ledger::RowView> filtered;
+    if (ledger) {
+        filtered = currentQuery().rows(*ledger);
     }
 
     // Populate the table with the filtered transactions
@@ -123,11 +159,30 @@ void ViewTransactions::applyFiltering()
 }
 
 
-void ViewTransactions::populateViewTable(const std::vector<Transaction> &transactions, bool showBalance, bool showTotalRow)
+bool ViewTransactions::matchesFilters(const Ledger::RowView &transaction) const
+{
+    return currentQuery().matches(transaction);
+}
+
+LedgerQuery ViewTransactions::currentQuery() const
+{
+    LedgerQuery query;
+    query.setCategory(currentCategoryFilter);
+    query.setSubcategoryText(currentSubCategoryFilter);
+    return query;
+}
+
+void ViewTransactions::populateViewTable(const std::vector<Ledger::RowView> &transactions, bool showBalance, bool showTotalRow)
 {
     ui->transactionTableWidget->clearContents();
     ui->transactionTableWidget->setRowCount(0);
 
+    showingBalance = showBalance;
+    showingTotalRow = showTotalRow;
+    rowBalances.clear();
+    rowDays.clear();
+    rowDays.reserve(transactions.size());
+
     // Set headers
     QStringList headers;
     headers << "Date";
@@ -137,67 +192,96 @@ void ViewTransactions::populateViewTable(const std::vector<Transaction> &transac
 
     ui->transactionTableWidget->setColumnCount(headers.size());
     ui->transactionTableWidget->setHorizontalHeaderLabels(headers);
+    ui->transactionTableWidget->setRowCount(static_cast<int>(transactions.size()));
 
-    double runningBalance = 0.0;
-    for (auto &t : transactions) {
-        // Get the transaction amount minus witholdings.
-        double netAmount = t.calculateNetAmount();
-
-        // Add or subtract that amount from the running balance.
-        if (t.isIncomeTransaction()) {
-            runningBalance += netAmount;
-        } else {
-            runningBalance -= netAmount;
-        }
-
-        // Add a new row to the bottom of the table
-        int row = ui->transactionTableWidget->rowCount();
-        ui->transactionTableWidget->insertRow(row);
-
-        // Insert transaction details into the columns of this row.
-        int currColumn = 0;
-        ui->transactionTableWidget->setItem(row, currColumn++, new QTableWidgetItem(QString::fromStdString(t.getDate())));
+    Money runningBalance;
+    int row = 0;
+    for (const Ledger::RowView &t : transactions) {
+        // The ledger keeps the amount minus witholdings, signed for the running balance.
+        Money signedAmount = t.signedNetAmount();
+        runningBalance += signedAmount;
 
         if (showBalance) {
-            ui->transactionTableWidget->setItem(row, currColumn++, new QTableWidgetItem(QString::fromStdString(t.getCategory())));
+            rowBalances.push_back(runningBalance);
         }
 
-        ui->transactionTableWidget->setItem(row, currColumn++, new QTableWidgetItem(QString::fromStdString(t.getSubcategory())));
-
-        double amt = t.isIncomeTransaction() ? netAmount : -netAmount;
-        ui->transactionTableWidget->setItem(row, currColumn++, new QTableWidgetItem(QString::number(amt, 'f', 2)));
-
-        if (showBalance) {
-            ui->transactionTableWidget->setItem(row, currColumn++, new QTableWidgetItem(QString::number(runningBalance, 'f', 2)));
-        }
+        // Insert transaction details into the columns of this row.
+        rowDays.push_back(t.getDay());
+        setRowItems(row++, t, signedAmount, runningBalance);
     }
+    filteredTotal = runningBalance;
 
     // If a filter is applied, show the total balance in the last row of the table.
     if (!showBalance && showTotalRow && !transactions.empty()) {
-        // Insert TOTAL row
-        int totalRow = ui->transactionTableWidget->rowCount();
-        ui->transactionTableWidget->insertRow(totalRow);
-        ui->transactionTableWidget->setItem(totalRow, 0, new QTableWidgetItem(""));
-        ui->transactionTableWidget->setItem(totalRow, 1, new QTableWidgetItem("TOTAL"));
-        ui->transactionTableWidget->setItem(totalRow, 2, new QTableWidgetItem(QString::number(runningBalance, 'f', 2)));
+        updateTotalRow();
     }
 
     // Always stretch columns
     ui->transactionTableWidget->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
 }
 
+void ViewTransactions::setRowItems(int row, const Ledger::RowView &transaction, Money signedAmount, Money balance)
+{
+    int currColumn = 0;
+    ui->transactionTableWidget->setItem(row, currColumn++, new QTableWidgetItem(DateUtil::toString(transaction.getDay())));
+
+    if (showingBalance) {
+        ui->transactionTableWidget->setItem(row, currColumn++, new QTableWidgetItem(QString::fromStdString(transaction.getCategory())));
+    }
+
+    ui->transactionTableWidget->setItem(row, currColumn++, new QTableWidgetItem(QString::fromStdString(transaction.getSubcategory())));
+    ui->transactionTableWidget->setItem(row, currColumn++, new QTableWidgetItem(signedAmount.toString()));
+
+    if (showingBalance) {
+        ui->transactionTableWidget->setItem(row, currColumn++, new QTableWidgetItem(balance.toString()));
+    }
+}
+
+int ViewTransactions::tableRowForDay(int day) const
+{
+    // rowDays covers the data rows only, so a trailing TOTAL row is never a candidate
+    return static_cast<int>(std::upper_bound(rowDays.begin(), rowDays.end(), day) - rowDays.begin());
+}
+
+void ViewTransactions::updateTotalRow()
+{
+    const QString totalText = filteredTotal.toString();
+
+    // rowDays tracks the data rows, so any row past them is the TOTAL row
+    int lastRow = ui->transactionTableWidget->rowCount() - 1;
+    if (ui->transactionTableWidget->rowCount() > static_cast<int>(rowDays.size())) {
+        ui->transactionTableWidget->item(lastRow, 2)->setText(totalText);
+        return;
+    }
+
+    // Insert TOTAL row
+    int totalRow = ui->transactionTableWidget->rowCount();
+    ui->transactionTableWidget->insertRow(totalRow);
+    ui->transactionTableWidget->setItem(totalRow, 0, new QTableWidgetItem(""));
+    ui->transactionTableWidget->setItem(totalRow, 1, new QTableWidgetItem("TOTAL"));
+    ui->transactionTableWidget->setItem(totalRow, 2, new QTableWidgetItem(totalText));
+}
+
 void ViewTransactions::resetUI()
 {
+    bool filtersApplied = !currentCategoryFilter.isEmpty() || !currentSubCategoryFilter.isEmpty();
+
+    // Reset the filter widgets without triggering a refilter for each of them
+    ui->categoryComboBox->blockSignals(true);
+    ui->subcategoryLineEdit->blockSignals(true);
     ui->categoryComboBox->setCurrentIndex(0);
     ui->subcategoryLineEdit->clear();
+    ui->categoryComboBox->blockSignals(false);
+    ui->subcategoryLineEdit->blockSignals(false);
+
     ui->optionsGroupBox->setVisible(false);
     ui->label->setText("Show Options");
-    ui->transactionTableWidget->clearContents();
-    ui->transactionTableWidget->setRowCount(0);
 
     currentCategoryFilter = "";
     currentSubCategoryFilter = "";
 
-    // Re-apply filtering with defaults
-    applyFiltering();
+    // The unfiltered table is kept up to date incrementally, so only rebuild it if filters were active
+    if (filtersApplied) {
+        applyFiltering();
+    }
 }
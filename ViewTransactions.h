@@ -2,8 +2,11 @@
 #define VIEWTRANSACTIONS_H
 
 #include <QWidget>
+#include <memory>
 #include <vector>
 #include "Transaction.h"
+#include "Ledger.h"
+#include "LedgerQuery.h"
 #include "User.h"
 
 namespace Ui {
@@ -28,6 +31,21 @@ public:
      */
     ~ViewTransactions();
 
+    /**
+     * @brief Sets the ledger whose transactions are displayed, and rebuilds the table.
+     *
+     * The ledger is shared, not copied; subcategory searches use its trigram index. The
+     * view subscribes to the ledger's changes and keeps itself current.
+     *
+     * @param ledger The current user's ledger; may be null to show nothing.
+     */
+    void setLedger(std::shared_ptr<const Ledger> ledger);
+
+    /**
+     * @brief Rebuilds the table after the ledger was cleared or reloaded.
+     */
+    void refresh();
+
     /**
      * @brief Sets the current user.
      * @param user Current user.
@@ -35,10 +53,14 @@ public:
     void setCurrentUser(const User &user);
 
     /**
-     * @brief Sets all transactions for this user.
-     * @param transactions Vector of all user transactions.
+     * @brief Shows a single newly saved transaction, already added to the ledger, by patching the table in place.
+     *
+     * The matching row is inserted at its date position; later running balances or the
+     * TOTAL row are adjusted instead of rebuilding the whole table.
+     *
+     * @param transaction The ledger row of the transaction that was saved.
      */
-    void setAllTransactions(const std::vector<Transaction> &transactions);
+    void addTransaction(const Ledger::RowView &transaction);
 
     /**
      * @brief Resets all UI elements to their default state.
@@ -68,9 +90,38 @@ private slots:
 private:
     Ui::ViewTransactions *ui; ///< Pointer to the UI components of ViewTransactions.
     User currentUser; ///< The current user whose transactions are being viewed.
-    std::vector<Transaction> allTransactions; ///< All transactions associated with the current user.
+    std::shared_ptr<const Ledger> ledger; ///< The current user's transactions, shared with the other views; may be null.
+    int ledgerSubscription; ///< Token of the subscription to ledger's changes, or 0.
     QString currentCategoryFilter; ///< Current category filter applied to the transactions.
     QString currentSubCategoryFilter; ///< Current subcategory filter applied to the transactions.
+    bool showingBalance; ///< True if the table currently shows the Balance column.
+    bool showingTotalRow; ///< True if the table currently ends with a TOTAL row when non-empty.
+    std::vector<Money> rowBalances; ///< Running balance of each table row while showingBalance is set.
+    std::vector<int> rowDays; ///< Day number of each data row, in table order.
+    Money filteredTotal; ///< Sum of the signed amounts of the displayed rows.
+
+    /**
+     * @brief Checks whether a transaction passes the current category/subcategory filters.
+     * @param transaction The transaction to check.
+     * @return true if the transaction should be displayed, false otherwise.
+     */
+    bool matchesFilters(const Ledger::RowView &transaction) const;
+
+    /**
+     * @brief Updates the table for a change of the ledger.
+     *
+     * A single added row is patched in with addTransaction(); anything larger rebuilds
+     * the table, since later rows of a batch would already be in the balances it reads.
+     *
+     * @param change The change.
+     */
+    void applyLedgerChange(const Ledger::Change &change);
+
+    /**
+     * @brief Builds a ledger query from the current category/subcategory filters.
+     * @return The query.
+     */
+    LedgerQuery currentQuery() const;
 
     /**
      * @brief Apply category/subcategory filtering and populate the transaction table.
@@ -79,11 +130,32 @@ private:
 
     /**
      * @brief Populate the transactionTableWidget based on given transactions and display mode.
-     * @param transactions The filtered transactions.
+     * @param transactions The filtered rows of the ledger.
      * @param showBalance If true, show balance column and no TOTAL row.
      * @param showTotalRow If true, shows TOTAL row at bottom (when no balance).
      */
-    void populateViewTable(const std::vector<Transaction> &transactions, bool showBalance, bool showTotalRow);
+    void populateViewTable(const std::vector<Ledger::RowView> &transactions, bool showBalance, bool showTotalRow);
+
+    /**
+     * @brief Fills the cells of one table row for the given transaction.
+     * @param row The table row to fill.
+     * @param transaction The transaction displayed in the row.
+     * @param signedAmount The net amount, negative for expenses.
+     * @param balance The running balance after this row (used only when showingBalance is set).
+     */
+    void setRowItems(int row, const Ledger::RowView &transaction, Money signedAmount, Money balance);
+
+    /**
+     * @brief Finds the table row where a transaction on the given day belongs.
+     * @param day The transaction date as a day number.
+     * @return The index of the first data row dated after the given day.
+     */
+    int tableRowForDay(int day) const;
+
+    /**
+     * @brief Adds the TOTAL row if it is missing, or refreshes its amount.
+     */
+    void updateTotalRow();
 };
 
 #endif // VIEWTRANSACTIONS_H
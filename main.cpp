@@ -1,12 +1,250 @@
 #include <QApplication>
+#include <QCoreApplication>
+#include <QCommandLineParser>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QTextStream>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <cstring>
 #include "MainWindow.h"
+#include "CsvImporter.h"
+#include "Database.h"
+#include "DailyTotals.h"
+#include "Ledger.h"
+#include "LedgerReport.h"
+#include "StatementCache.h"
+#include "StringInterner.h"
+#include "Transaction.h"
+
+/**
+ * @brief Checks whether an option was given on the command line, e.g. to select a headless mode.
+ */
+static bool hasArgument(int argc, char *argv[], const char *name)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Imports a CSV file without a GUI, e.g. `PersonalFinanceManager --import statement.csv --user 3`.
+ */
+static int runHeadlessImport(const QCoreApplication &app)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Imports a CSV bank statement into the transactions table.");
+    parser.addHelpOption();
+    QCommandLineOption importOption("import", "CSV file to import.", "file");
+    QCommandLineOption userOption("user", "User ID that owns the imported transactions.", "id");
+    QCommandLineOption databaseOption("database", "SQLite database file.", "file", Database::defaultPath());
+    parser.addOption(importOption);
+    parser.addOption(userOption);
+    QCommandLineOption profileOption("storage-profile", "Storage profile: durable, balanced or bulk-import.", "name",
+                                     Database::storageProfileName(Database::configuredStorageProfile()));
+    parser.addOption(databaseOption);
+    parser.addOption(profileOption);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    bool ok = false;
+    int userId = parser.value(userOption).toInt(&ok);
+    if (!ok || userId <= 0) {
+        err << "A valid --user id is required." << Qt::endl;
+        return 1;
+    }
+
+    StorageProfile profile;
+    if (!Database::storageProfileFromName(parser.value(profileOption), profile)) {
+        err << "Unknown storage profile: " << parser.value(profileOption) << Qt::endl;
+        return 1;
+    }
+
+    QSqlDatabase db = Database::open(parser.value(databaseOption));
+    if (!db.isOpen()) {
+        err << "Failed to open database: " << db.lastError().text() << Qt::endl;
+        return 1;
+    }
+    Database::applyStorageProfile(db, profile);
+    if (!Database::ensureSchema(db)) {
+        err << "Failed to create the database tables." << Qt::endl;
+        return 1;
+    }
+
+    CsvImporter importer(userId);
+    int lastPercent = -1;
+    QObject::connect(&importer, &CsvImporter::progress, [&err, &lastPercent](qint64 bytesRead, qint64 totalBytes) {
+        int percent = totalBytes > 0 ? static_cast<int>(bytesRead * 100 / totalBytes) : 100;
+        if (percent != lastPercent) {
+            lastPercent = percent;
+            err << "\rImporting... " << percent << "%" << Qt::flush;
+        }
+    });
+    QObject::connect(&importer, &CsvImporter::rowRejected, [&err](qint64 recordNumber, const QString &reason) {
+        err << "\nRecord " << recordNumber << " rejected: " << reason << Qt::flush;
+    });
+
+    CsvImporter::Result result = importer.importFile(db, parser.value(importOption));
+    err << Qt::endl;
+    StatementCache::forDatabase(db).logStatistics();
+    StatementCache::release(db);
+
+    if (!result.error.isEmpty()) {
+        err << "Import failed: " << result.error << Qt::endl;
+        return 1;
+    }
+
+    double seconds = result.elapsedMs / 1000.0;
+    err << "Imported " << result.rowsImported << " of " << result.rowsRead << " rows ("
+        << result.rowsRejected << " rejected) in " << QString::number(seconds, 'f', 2) << " s";
+    if (seconds > 0.0) {
+        err << ", " << QString::number(result.rowsRead / seconds, 'f', 0) << " rows/s";
+    }
+    err << Qt::endl;
+    return 0;
+}
+
+/**
+ * @brief Compares the daily_totals rollup with the transactions table, e.g.
+ * `PersonalFinanceManager --check-totals --repair`.
+ */
+static int runHeadlessTotalsCheck(const QCoreApplication &app)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Checks the daily_totals rollup against the transactions table.");
+    parser.addHelpOption();
+    QCommandLineOption checkOption("check-totals", "Check the daily totals.");
+    QCommandLineOption repairOption("repair", "Rebuild the daily totals if they differ.");
+    QCommandLineOption databaseOption("database", "SQLite database file.", "file", Database::defaultPath());
+    parser.addOption(checkOption);
+    parser.addOption(repairOption);
+    parser.addOption(databaseOption);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    QSqlDatabase db = Database::open(parser.value(databaseOption));
+    if (!db.isOpen()) {
+        err << "Failed to open database: " << db.lastError().text() << Qt::endl;
+        return 1;
+    }
+    if (!Database::ensureSchema(db)) {
+        err << "Failed to create the database tables." << Qt::endl;
+        return 1;
+    }
+
+    int mismatches = DailyTotals::verify(db);
+    if (mismatches < 0) {
+        err << "Failed to check the daily totals." << Qt::endl;
+        return 1;
+    }
+    if (mismatches == 0) {
+        err << "Daily totals are consistent." << Qt::endl;
+        return 0;
+    }
+
+    err << mismatches << " daily total rows differ from the transactions." << Qt::endl;
+    if (!parser.isSet(repairOption)) {
+        return 2;
+    }
+
+    QString error;
+    if (!db.transaction() || !DailyTotals::rebuild(db, error) || !db.commit()) {
+        db.rollback();
+        err << "Failed to rebuild the daily totals: " << error << Qt::endl;
+        return 1;
+    }
+    err << "Daily totals rebuilt." << Qt::endl;
+    return 0;
+}
+
+/**
+ * @brief Prints a user's net amounts per month, category and type, e.g.
+ * `PersonalFinanceManager --report --user 3 --threads 4`.
+ */
+static int runHeadlessReport(const QCoreApplication &app)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Prints a user's transactions aggregated per month, category and type.");
+    parser.addHelpOption();
+    QCommandLineOption reportOption("report", "Print the monthly report.");
+    QCommandLineOption userOption("user", "User ID whose transactions are reported.", "id");
+    QCommandLineOption threadsOption("threads", "Threads to aggregate with; 0 uses every core.", "count", "0");
+    QCommandLineOption databaseOption("database", "SQLite database file.", "file", Database::defaultPath());
+    parser.addOption(reportOption);
+    parser.addOption(userOption);
+    parser.addOption(threadsOption);
+    parser.addOption(databaseOption);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    bool ok = false;
+    int userId = parser.value(userOption).toInt(&ok);
+    if (!ok || userId <= 0) {
+        err << "A valid --user id is required." << Qt::endl;
+        return 1;
+    }
+    int threads = parser.value(threadsOption).toInt(&ok);
+    if (!ok || threads < 0) {
+        err << "--threads must be a non-negative number." << Qt::endl;
+        return 1;
+    }
+
+    QSqlDatabase db = Database::open(parser.value(databaseOption));
+    if (!db.isOpen()) {
+        err << "Failed to open database: " << db.lastError().text() << Qt::endl;
+        return 1;
+    }
+    if (!Database::ensureSchema(db)) {
+        err << "Failed to create the database tables." << Qt::endl;
+        return 1;
+    }
+
+    Ledger ledger;
+    ledger.addTransactions(Transaction::readTransactionsForUser(db, userId));
+
+    QElapsedTimer timer;
+    timer.start();
+    const std::vector<LedgerReport::Group> groups = LedgerReport::byMonthAndCategory(ledger, threads);
+    const qint64 elapsedUs = timer.nsecsElapsed() / 1000;
+
+    QTextStream out(stdout);
+    out << "month\tcategory\ttype\tcount\tsum\tmin\tmax\tmean" << Qt::endl;
+    for (const LedgerReport::Group &group : groups) {
+        out << QString("%1-%2").arg(group.year(), 4, 10, QChar('0')).arg(group.monthOfYear(), 2, 10, QChar('0'))
+            << '\t' << QString::fromStdString(StringInterner::lookup(group.categoryId))
+            << '\t' << (group.income ? "Income" : "Expense")
+            << '\t' << group.count
+            << '\t' << group.sum.toString()
+            << '\t' << group.minimum.toString()
+            << '\t' << group.maximum.toString()
+            << '\t' << group.mean().toString() << '\n';
+    }
+    out.flush();
+
+    err << "Aggregated " << ledger.size() << " transactions into " << groups.size() << " groups in "
+        << QString::number(elapsedUs / 1000.0, 'f', 2) << " ms" << Qt::endl;
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
+    if (hasArgument(argc, argv, "--import")) {
+        QCoreApplication a(argc, argv);
+        return runHeadlessImport(a);
+    }
+    if (hasArgument(argc, argv, "--check-totals")) {
+        QCoreApplication a(argc, argv);
+        return runHeadlessTotalsCheck(a);
+    }
+    if (hasArgument(argc, argv, "--report")) {
+        QCoreApplication a(argc, argv);
+        return runHeadlessReport(a);
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();